@@ -2,98 +2,296 @@
 // Tested by: 	Ajay Srivastava, Srihari Chekuri
 
 #include <cassert>
+#include <cmath>
 #include <iostream>
 #include <vector>
 
 #include "astar.h"
-#include "heap.h"
-#include "heap.cpp"
-#include "mathfun.h"
 
 using namespace arma;
 using namespace std;
 
-static MotionAction getPreviousAction(MotionAction currAction, imat &backtrace);
-static vector<MotionAction> getNextAction(MotionAction currAction, mat &map);
+// the four moves, indexed by ActionId - MOVE_FORWARD
+static const int move_dx[4] = { 0, 0, -1, 1 };
+static const int move_dy[4] = { 1, -1, 0, 0 };
+
+static double step_cost(int from, int to);
+static int jump_x(const cspace_grid &cspace, int x, int y, int dx, int tx, int ty);
+static int jump_y(const cspace_grid &cspace, int x, int y, int dy, int tx, int ty);
 
 /** The goal of this function is to initialize the AStar algorithm,
  *  including any data structures which you are to use in the
  *  computation of the next state
  *  @param map This is the map which you are given
  *  @param goal This is the goal of the robot
+ *  @param mode how to search, see SearchMode
  */
-AStar::AStar(mat map, vec &goal) : isComplete(false), isImpossible(false), goal(goal)
+AStar::AStar(mat map, vec &goal, enum SearchMode mode) :
+	goal(goal), mode(mode), nexpanded(0), isComplete(false), isImpossible(false)
 {
 	this->map = map.t();
+	integral_image occupancy;
+	occupancy.build(this->map);
+	shared_ptr<cspace_grid> cspace = make_shared<cspace_grid>();
+	cspace->build(occupancy, ASTAR_CLEARANCE);
+	this->cspace = cspace;
 	assert(0 <= goal(0) && goal(0) < (int)this->map.n_rows && 0 <= goal(1) && goal(1) < (int)this->map.n_cols);
+	this->reserve();
+}
+
+/** Initialize the search on a configuration space that is already built,
+ *	so that many planners can share one copy of the map. The map member is
+ *	left empty
+ *	@param cspace the configuration space of the transposed map (x down the
+ *		rows), see cspace_grid::build
+ *	@param goal This is the goal of the robot
+ *	@param mode how to search, see SearchMode
+ */
+AStar::AStar(shared_ptr<const cspace_grid> cspace, vec &goal, enum SearchMode mode) :
+	goal(goal), cspace(cspace), mode(mode), nexpanded(0), isComplete(false), isImpossible(false)
+{
+	assert(0 <= goal(0) && goal(0) < cspace->n_rows && 0 <= goal(1) && goal(1) < cspace->n_cols);
+	this->reserve();
 }
 
 AStar::~AStar(void)
 {
 }
 
+/** Grab all the memory the searches will need, once
+ */
+void AStar::reserve(void)
+{
+	int ncells = this->cspace->n_rows * this->cspace->n_cols;
+	search_node blank = { 0, 0, 0, 0, 0 };
+	this->nodes.assign(ncells, blank);
+	this->generation = 0;
+	this->opened.reserve(ncells);
+}
+
+/** Change the goal, keeping the memory from the earlier searches
+ *	@param goal the new goal of the robot
+ */
+void AStar::set_goal(vec &goal)
+{
+	assert(0 <= goal(0) && goal(0) < this->cspace->n_rows && 0 <= goal(1) && goal(1) < this->cspace->n_cols);
+	this->goal = goal;
+	this->isComplete = false;
+	this->isImpossible = false;
+}
+
+/** Offer a cheaper way to a node, which (re)opens it if it is cheaper than
+ *	what the node has this generation
+ *	@param key the node
+ *	@param parent the node it is reached from
+ *	@param action the move into the node
+ *	@param g the cost of reaching it this way
+ *	@param h the heuristic cost from the node
+ */
+void AStar::relax(uint32_t key, uint32_t parent, int action, double g, double h)
+{
+	search_node &next = this->nodes[key];
+	bool fresh = next.stamp != this->generation;
+	if (!fresh && (next.closed || !(g < next.g)))
+	{
+		return;
+	}
+	next.g = g;
+	next.parent = parent;
+	next.stamp = this->generation;
+	next.action = (uint8_t)action;
+	next.closed = 0;
+	this->opened.push(key, g + h);
+}
+
 /** In this function, you are to get the next state off the
  *  priority queue and then traverse to that state,
  *  computing the cost and placing the state that was traversed
  *  into the search space
+ *  The search runs backward from the goal, so the heuristic is the
+ *  straight line distance to the start. Nothing is allocated here except
+ *  what the path needs beyond its old capacity
+ *  In SEARCH_JPS mode a node's successors are the next jump points in each
+ *  direction the canonical paths allow, and the jumps are filled back in
+ *  cell by cell, so the path looks the same either way
+ *  @param start the cell the robot is in
+ *  @param path (output) the moves from the start to the goal
  */
 void AStar::compute(vec &start, vector<MotionAction> &path)
 {
 	this->isComplete = false;
 	this->isImpossible = false;
+	this->nexpanded = 0;
 
-	MotionAction start_state(this->goal(0), this->goal(1)); // changed to backward
-	Heap<MotionAction> opened;
-	opened.push(start_state, sum(abs(start - goal)));
+	const cspace_grid &cspace = *this->cspace;
+	int n_cols = cspace.n_cols;
+	int sx = (int)round(start(0));
+	int sy = (int)round(start(1));
+	int gx = (int)this->goal(0);
+	int gy = (int)this->goal(1);
+	if (!cspace.free(sx, sy) || !cspace.free(gx, gy))
+	{ // nothing can reach a cell the robot doesn't fit in
+		this->isImpossible = true;
+		return;
+	}
+	uint32_t start_key = (uint32_t)sx * n_cols + sy;
+	uint32_t goal_key = (uint32_t)gx * n_cols + gy;
 
-	// create a matrix of parents that have been closed
-	imat closed(this->map.n_rows, this->map.n_cols, fill::zeros);
-	imat backtrace(this->map.n_rows, this->map.n_cols, fill::zeros);
+	// start a new generation, and only clear the stamps when they wrap
+	if (++this->generation == 0)
+	{
+		for (search_node &node : this->nodes)
+		{
+			node.stamp = 0;
+		}
+		this->generation = 1;
+	}
+	search_node *nodes = this->nodes.data();
+	this->opened.clear();
+	this->relax(goal_key, goal_key, STARTING_ACTION, 0, hypot(gx - sx, gy - sy)); // changed to backward
 
 	// after pushing the initial state, start trying to get the next state
-	while (!opened.empty())
+	while (!this->opened.empty())
 	{
 		// grab a state
-		MotionAction curr = opened.pop();
-		double x = curr.x;
-		double y = curr.y;
+		uint32_t key = (uint32_t)this->opened.pop();
+		search_node &curr = nodes[key];
+		curr.closed = 1;
+		this->nexpanded++;
 
-		closed(x, y) = true;
 		// if this state is the goal state, then return the path
-		if (abs(x - start(0)) < 0.5 && abs(y - start(1)) < 0.5)
-		{ // changed to backward
+		if (key == start_key)
+		{ // changed to backward, so following the parents walks to the goal
 			path.clear();
-			while (x != this->goal(0) || y != this->goal(1))
-			{ // changed to backward
-				path.push_back(curr);
-				curr = getPreviousAction(curr, backtrace);
-				x = curr.x;
-				y = curr.y;
+			while (key != goal_key)
+			{
+				const search_node &node = nodes[key];
+				const search_node &prev = nodes[node.parent];
+				int k = node.action - MOVE_FORWARD;
+				int x = key / n_cols;
+				int y = key % n_cols;
+				int run = abs(x - (int)(node.parent / n_cols)) + abs(y - (int)(node.parent % n_cols));
+				double turn = step_cost(prev.action, node.action);
+				// fill in the cells of the jump, walking back toward the parent
+				for (int j = run; j >= 1; j--)
+				{
+					MotionAction action(x, y, (enum ActionId)node.action);
+					action.cost = (j == 1) ? turn : 1;
+					action.gcost = prev.g + turn + (j - 1);
+					path.push_back(action);
+					x -= move_dx[k];
+					y -= move_dy[k];
+				}
+				key = node.parent;
 			}
-			path.push_back(curr);
-			//reverse(path.begin(), path.end());
+			path.push_back(MotionAction(gx, gy, STARTING_ACTION));
 			this->isComplete = true;
 			return;
 		}
-		// otherwise try to find new neighbors and add them in
-		vector<MotionAction> next_actions = getNextAction(curr, this->map);
-		for (MotionAction &action : next_actions)
+
+		// otherwise try to find new neighbors and add them in, or lower
+		// their cost if this is a cheaper way to them
+		int x = key / n_cols;
+		int y = key % n_cols;
+		for (int i = 0; i < 4; i++)
 		{
-			x = action.x;
-			y = action.y;
-			if (!backtrace(x, y) && !closed(x, y))
+			int action = MOVE_FORWARD + i;
+			int dx = move_dx[i];
+			int dy = move_dy[i];
+			int nx = x + dx;
+			int ny = y + dy;
+			if (this->mode == SEARCH_JPS && curr.action != STARTING_ACTION)
+			{ // prune the directions no canonical path takes from here
+				int k = curr.action - MOVE_FORWARD;
+				if (dx == -move_dx[k] && dy == -move_dy[k])
+				{ // never back up
+					continue;
+				}
+				if (move_dx[k] == 0 && dx != 0 && !(!cspace.free(x + dx, y - move_dy[k]) && cspace.free(nx, ny)))
+				{ // y moves only turn where a wall forces them to
+					continue;
+				}
+			}
+			// check feasibility of the action
+			if (!cspace.free(nx, ny))
+			{
+				continue;
+			}
+			if (this->mode == SEARCH_JPS)
 			{
-				backtrace(x, y) = action.id;
-				assert(action.id != 0); // just in case
-				// euclidean distance
-				double hcost = action.gcost + eucdist(action.pos - goal);
-				opened.push(action, hcost);
+				int jump = (dx != 0) ? jump_x(cspace, x, y, dx, sx, sy) : jump_y(cspace, x, y, dy, sx, sy);
+				if (jump < 0)
+				{
+					continue;
+				}
+				nx = jump / n_cols;
+				ny = jump % n_cols;
 			}
+			uint32_t next_key = (uint32_t)nx * n_cols + ny;
+			double g = curr.g + step_cost(curr.action, action) + (abs(nx - x) + abs(ny - y) - 1);
+			// euclidean distance
+			this->relax(next_key, key, action, g, hypot(nx - sx, ny - sy));
 		}
 	}
 	this->isImpossible = true;
 }
 
+/** Jump along y from a cell, for SEARCH_JPS. A y move goes straight until
+ *	it reaches the target or a cell beside a wall corner, where the path
+ *	might have to turn onto x
+ *	@param cspace where the footprint fits
+ *	@param x the x of the cell to jump from
+ *	@param y the y of the cell to jump from
+ *	@param dy the direction, +1 or -1
+ *	@param tx the x of the target
+ *	@param ty the y of the target
+ *	@return the key of the jump point, or -1 if it runs into a wall
+ */
+static int jump_y(const cspace_grid &cspace, int x, int y, int dy, int tx, int ty)
+{
+	while (true)
+	{
+		y += dy;
+		if (!cspace.free(x, y))
+		{
+			return -1;
+		}
+		if ((x == tx && y == ty) ||
+			(!cspace.free(x - 1, y - dy) && cspace.free(x - 1, y)) ||
+			(!cspace.free(x + 1, y - dy) && cspace.free(x + 1, y)))
+		{
+			return x * cspace.n_cols + y;
+		}
+	}
+}
+
+/** Jump along x from a cell, for SEARCH_JPS. x moves come first on the
+ *	canonical paths, so any cell of an x run can turn onto y, and it is a
+ *	jump point if a y jump from it finds one
+ *	@param cspace where the footprint fits
+ *	@param x the x of the cell to jump from
+ *	@param y the y of the cell to jump from
+ *	@param dx the direction, +1 or -1
+ *	@param tx the x of the target
+ *	@param ty the y of the target
+ *	@return the key of the jump point, or -1 if it runs into a wall
+ */
+static int jump_x(const cspace_grid &cspace, int x, int y, int dx, int tx, int ty)
+{
+	while (true)
+	{
+		x += dx;
+		if (!cspace.free(x, y))
+		{
+			return -1;
+		}
+		if ((x == tx && y == ty) || jump_y(cspace, x, y, 1, tx, ty) >= 0 || jump_y(cspace, x, y, -1, tx, ty) >= 0)
+		{
+			return x * cspace.n_cols + y;
+		}
+	}
+}
+
 /** Return whether or not the goal is impossible to reach
  *  @return true if it is impossible, false otherwise
  */
@@ -110,62 +308,16 @@ bool AStar::complete(void)
 	return this->isComplete;
 }
 
-/** Return the parent action of the current action
- *  @param currAction the current action of the robot
- *  @param backtrace a matrix of all backtraced actions
- *  @return the parent action
+/** Return the cost of a move, given the move before it
+ *  @param from the move into the current cell
+ *  @param to the next move
+ *  @return the cost
  */
-static MotionAction getPreviousAction(MotionAction currAction, imat &backtrace)
+static double step_cost(int from, int to)
 {
-	mat neighbor4 = reshape(mat({
-			0, 0, -1, 1,
-			1, -1, 0, 0
-		}), 4, 2).t();
-	if (currAction.id == STARTING_ACTION)
-	{
-		return currAction;
-	}
-	else
-	{
-		vec neighbor = neighbor4.col(currAction.id - MOVE_FORWARD);
-		vec pos = currAction.pos - neighbor;
-		MotionAction parent(pos(0), pos(1), (enum ActionId)backtrace(pos(0), pos(1)));
-		parent.cost = 1;
-		parent.gcost = currAction.gcost - parent.cost;
-		return parent;
-	}
+	bool h1 = from == MOVE_LEFT || from == MOVE_RIGHT;
+	bool v1 = from == MOVE_FORWARD || from == MOVE_BACKWARD;
+	bool h2 = to == MOVE_LEFT || from == MOVE_RIGHT;
+	bool v2 = to == MOVE_FORWARD || from == MOVE_BACKWARD;
+	return ((h1 && v2) || (v1 && h2)) ? 3 : (to != from ? 5 : 1); // have this cost function take into account the pose difference
 }
-
-/** Return a vector of possible actions at this particular action
- *  @param currAction the current action of the robot)
- *  @param map the map of the environment
- *  @return the list of possible actions
- */
-static vector<MotionAction> getNextAction(MotionAction currAction, mat &map)
-{
-	mat neighbor4 = reshape(mat({
-			0, 0, -1, 1,
-			1, -1, 0, 0
-		}), 4, 2).t();
-	vector<enum ActionId> neighborActions = { MOVE_FORWARD, MOVE_BACKWARD, MOVE_LEFT, MOVE_RIGHT };
-	vector<MotionAction> actionlist;
-	for (int i = 0; i < 4; i++)
-	{
-		MotionAction action(currAction.x + neighbor4(0, i), currAction.y + neighbor4(1, i), neighborActions[i]);
-		// check feasibility of the action
-		if (action.x-10 < 0 || action.y-10 < 0 ||
-				action.x+10 >= map.n_rows || action.y+10 >= map.n_cols ||
-				accu(map(span(action.x-10, action.x+10), span(action.y-10, action.y+10))) > 0.5)
-		{
-			continue;
-		}
-		bool h1 = currAction.id == MOVE_LEFT || currAction.id == MOVE_RIGHT;
-		bool v1 = currAction.id == MOVE_FORWARD || currAction.id == MOVE_BACKWARD;
-		bool h2 = action.id == MOVE_LEFT || currAction.id == MOVE_RIGHT;
-		bool v2 = action.id == MOVE_FORWARD || currAction.id == MOVE_BACKWARD;
-		action.cost = ((h1 && v2) || (v1 && h2)) ? 3 : (action.id != currAction.id ? 5 : 1); // have this cost function take into account the pose difference
-		action.gcost = currAction.gcost + action.cost;
-		actionlist.push_back(action);
-	}
-	return actionlist;
-}
\ No newline at end of file
@@ -20,7 +20,8 @@
 // #include <string>
 // #include <time.h>
 
-chili_landmarks::chili_landmarks()
+chili_landmarks::chili_landmarks() :
+	frames(0)
 {
 }
 
@@ -157,6 +158,7 @@ void chili_landmarks::update()
 			// sprintf(tagInfo, "id: %d x:%2.2f y:%2.2f", id, x_inches, y_inches);
 			// cv::putText(outputImage, tagInfo, center, cv::FONT_HERSHEY_SIMPLEX, 0.5, CV_RGB(0,255,0), 2.0);
 		}
+		this->frames++;
 
 		// Write stats on the current frame (resolution and processing time) to display window
         // cv::putText(outputImage, cv::format("%dx%d %4.0f ms (press q to quit)", outputImage.cols, outputImage.rows, processingTime), cv::Point(32,32), cv::FONT_HERSHEY_SIMPLEX, 0.5f, COLOR);
@@ -4,6 +4,8 @@
 #ifndef CHILI_LANDMARKS_H
 #define CHILI_LANDMARKS_H
 
+#include <atomic>
+
 class chili_landmarks
 {
 	public:
@@ -11,6 +13,7 @@ class chili_landmarks
 		~chili_landmarks();
 		void update();
 
+		std::atomic<int> frames; // camera frames processed, bumped after tags is filled in
 		double tags [1024][4];
 		// 0 -> detected
 		// 1 -> x
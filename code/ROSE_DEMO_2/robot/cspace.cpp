@@ -0,0 +1,38 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#include "cspace.h"
+
+using namespace std;
+
+cspace_grid::cspace_grid(void) :
+	n_rows(0), n_cols(0), radius(0)
+{
+}
+
+cspace_grid::~cspace_grid(void)
+{
+}
+
+/** Grow the walls by the footprint, this only needs to run again when the
+ *	map changes. Each cell is one box count on the wall counts, so the whole
+ *	grid is four lookups a cell no matter how big the robot is
+ *	@param occupancy the wall counts of the grid
+ *	@param radius the half width of the footprint, which covers
+ *		(2 radius + 1) x (2 radius + 1) cells
+ */
+void cspace_grid::build(const integral_image &occupancy, int radius)
+{
+	this->n_rows = occupancy.n_rows;
+	this->n_cols = occupancy.n_cols;
+	this->radius = radius;
+	this->cells.assign((size_t)this->n_rows * this->n_cols, 1);
+	for (int i = radius; i < this->n_rows - radius; i++)
+	{
+		uint8_t *row = this->cells.data() + (size_t)i * this->n_cols;
+		for (int j = radius; j < this->n_cols - radius; j++)
+		{
+			row[j] = occupancy.count(i - radius, j - radius, i + radius, j + radius) > 0;
+		}
+	}
+}
@@ -0,0 +1,44 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#ifndef CSPACE_H
+#define CSPACE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "integral.h"
+
+/** The configuration space of a square robot: one byte per cell that says
+ *	whether the robot's footprint, centered there, would touch a wall or
+ *	hang off the grid. That is the obstacles grown by a chessboard distance
+ *	threshold at the footprint's half width, so once it is built a
+ *	feasibility test is a single lookup
+ */
+class cspace_grid
+{
+	public:
+		cspace_grid(void);
+		~cspace_grid(void);
+		void build(const integral_image &occupancy, int radius);
+
+		/** Check if the footprint fits at a cell, cells off the grid never do
+		 *	@param row the row
+		 *	@param col the column
+		 *	@return true if it fits
+		 */
+		inline bool free(int row, int col) const
+		{
+			return (unsigned)row < (unsigned)this->n_rows && (unsigned)col < (unsigned)this->n_cols &&
+				!this->cells[(size_t)row * this->n_cols + col];
+		}
+
+		int n_rows;
+		int n_cols;
+		int radius; // half width of the footprint
+
+	private:
+		std::vector<uint8_t> cells; // row major, 1 where the footprint doesn't fit
+};
+
+#endif
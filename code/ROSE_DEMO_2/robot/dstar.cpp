@@ -0,0 +1,331 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "astar.h"
+#include "dstar.h"
+
+using namespace arma;
+using namespace std;
+
+// the four moves, indexed by ActionId - MOVE_FORWARD, so k ^ 1 is the
+// opposite of move k
+static const int move_dx[4] = { 0, 0, -1, 1 };
+static const int move_dy[4] = { 1, -1, 0, 0 };
+
+// D* Lite orders by a pair of costs, the second only breaking ties. Costs
+// are whole numbers smaller than this, so first * DSTAR_KEY_SCALE + second
+// is exact in a double and sorts the same way
+#define DSTAR_KEY_SCALE 4194304.0
+
+/** Initialize the planner on a map, building its configuration space the
+ *	same way AStar does
+ *	@param map This is the map which you are given
+ *	@param goal This is the goal of the robot
+ */
+DStarLite::DStarLite(mat map, vec &goal) :
+	goal(goal), nexpanded(0), isComplete(false), isImpossible(false)
+{
+	mat transposed = map.t();
+	integral_image occupancy;
+	occupancy.build(transposed);
+	shared_ptr<cspace_grid> cspace = make_shared<cspace_grid>();
+	cspace->build(occupancy, ASTAR_CLEARANCE);
+	this->cspace = cspace;
+	assert(0 <= goal(0) && goal(0) < cspace->n_rows && 0 <= goal(1) && goal(1) < cspace->n_cols);
+	this->reset();
+}
+
+/** Initialize the planner on a configuration space that is already built
+ *	@param cspace the configuration space of the transposed map (x down the
+ *		rows), see cspace_grid::build
+ *	@param goal This is the goal of the robot
+ */
+DStarLite::DStarLite(shared_ptr<const cspace_grid> cspace, vec &goal) :
+	goal(goal), cspace(cspace), nexpanded(0), isComplete(false), isImpossible(false)
+{
+	assert(0 <= goal(0) && goal(0) < cspace->n_rows && 0 <= goal(1) && goal(1) < cspace->n_cols);
+	this->reset();
+}
+
+DStarLite::~DStarLite(void)
+{
+}
+
+/** Throw away the search and start over from the goal
+ */
+void DStarLite::reset(void)
+{
+	int ncells = this->cspace->n_rows * this->cspace->n_cols;
+	assert(ncells < DSTAR_KEY_SCALE);
+	search_node blank = { HUGE_VAL, HUGE_VAL };
+	this->nodes.assign(ncells, blank);
+	this->opened.clear();
+	this->opened.reserve(ncells);
+	this->last_x = (int)this->goal(0);
+	this->last_y = (int)this->goal(1);
+	this->km = 0;
+
+	uint32_t goal_key = (uint32_t)this->last_x * this->cspace->n_cols + this->last_y;
+	this->nodes[goal_key].rhs = 0;
+	this->opened.push(goal_key, this->key(goal_key));
+}
+
+/** Change the goal. Every cost in the search is a cost to the goal, so
+ *	this starts the search over
+ *	@param goal the new goal of the robot
+ */
+void DStarLite::set_goal(vec &goal)
+{
+	assert(0 <= goal(0) && goal(0) < this->cspace->n_rows && 0 <= goal(1) && goal(1) < this->cspace->n_cols);
+	this->goal = goal;
+	this->isComplete = false;
+	this->isImpossible = false;
+	this->reset();
+}
+
+/** Switch to a new configuration space of the same size, after the map
+ *	changed. Only the cells that changed and their neighbors are put back
+ *	on the open list, the next compute carries the change as far as it
+ *	has to
+ *	@param cspace the new configuration space
+ */
+void DStarLite::update_map(shared_ptr<const cspace_grid> cspace)
+{
+	assert(cspace->n_rows == this->cspace->n_rows && cspace->n_cols == this->cspace->n_cols);
+	shared_ptr<const cspace_grid> old = this->cspace;
+	this->cspace = cspace;
+	int n_rows = cspace->n_rows;
+	int n_cols = cspace->n_cols;
+	for (int x = 0; x < n_rows; x++)
+	{
+		for (int y = 0; y < n_cols; y++)
+		{
+			if (old->free(x, y) == cspace->free(x, y))
+			{
+				continue;
+			}
+			this->update_node((uint32_t)x * n_cols + y);
+			for (int i = 0; i < 4; i++)
+			{
+				int nx = x + move_dx[i];
+				int ny = y + move_dy[i];
+				if ((unsigned)nx < (unsigned)n_rows && (unsigned)ny < (unsigned)n_cols)
+				{
+					this->update_node((uint32_t)nx * n_cols + ny);
+				}
+			}
+		}
+	}
+	this->isComplete = false;
+	this->isImpossible = false;
+}
+
+/** Get the open list priority of a cell for the current start
+ *	@param key the cell
+ *	@return the priority
+ */
+double DStarLite::key(uint32_t key) const
+{
+	const search_node &node = this->nodes[key];
+	double m = min(node.g, node.rhs);
+	int n_cols = this->cspace->n_cols;
+	int h = abs((int)(key / n_cols) - this->last_x) + abs((int)(key % n_cols) - this->last_y);
+	return (m + h + this->km) * DSTAR_KEY_SCALE + m;
+}
+
+/** Get the cost to the goal through a cell's best neighbor
+ *	@param key the cell
+ *	@return the cost, HUGE_VAL if the footprint doesn't fit there
+ */
+double DStarLite::lookahead(uint32_t key) const
+{
+	const cspace_grid &cspace = *this->cspace;
+	int n_cols = cspace.n_cols;
+	int x = key / n_cols;
+	int y = key % n_cols;
+	if (!cspace.free(x, y))
+	{
+		return HUGE_VAL;
+	}
+	double best = HUGE_VAL;
+	for (int i = 0; i < 4; i++)
+	{
+		int nx = x + move_dx[i];
+		int ny = y + move_dy[i];
+		if (cspace.free(nx, ny))
+		{
+			best = min(best, this->nodes[(uint32_t)nx * n_cols + ny].g + 1);
+		}
+	}
+	return best;
+}
+
+/** Bring a cell's lookahead up to date, and put it on the open list if
+ *	that makes it disagree with its cost, or take it off if it doesn't
+ *	@param key the cell
+ */
+void DStarLite::update_node(uint32_t key)
+{
+	search_node &node = this->nodes[key];
+	uint32_t goal_key = (uint32_t)this->goal(0) * this->cspace->n_cols + (uint32_t)this->goal(1);
+	if (key != goal_key)
+	{
+		node.rhs = this->lookahead(key);
+	}
+	if (node.g != node.rhs)
+	{
+		this->opened.push(key, this->key(key));
+	}
+	else
+	{
+		this->opened.erase(key);
+	}
+}
+
+/** Expand cells until the start's cost is right, which is only the cells
+ *	the last move or map change could have affected
+ *	@param start_key the cell the robot is in
+ */
+void DStarLite::repair(uint32_t start_key)
+{
+	int n_rows = this->cspace->n_rows;
+	int n_cols = this->cspace->n_cols;
+	while (!this->opened.empty() &&
+		(this->opened.top_priority() < this->key(start_key) ||
+		 this->nodes[start_key].rhs != this->nodes[start_key].g))
+	{
+		uint32_t key = (uint32_t)this->opened.top();
+		double k_old = this->opened.top_priority();
+		double k_new = this->key(key);
+		search_node &node = this->nodes[key];
+		this->nexpanded++;
+		if (k_old < k_new)
+		{ // made for an older start, so it goes back in where it belongs now
+			this->opened.push(key, k_new);
+			continue;
+		}
+		if (node.g > node.rhs)
+		{ // cheaper than it was, which settles it
+			node.g = node.rhs;
+			this->opened.erase(key);
+		}
+		else
+		{ // dearer than it was, so it and everything leaning on it gets redone
+			node.g = HUGE_VAL;
+			this->update_node(key);
+		}
+		int x = key / n_cols;
+		int y = key % n_cols;
+		for (int i = 0; i < 4; i++)
+		{
+			int nx = x + move_dx[i];
+			int ny = y + move_dy[i];
+			if ((unsigned)nx < (unsigned)n_rows && (unsigned)ny < (unsigned)n_cols)
+			{
+				this->update_node((uint32_t)nx * n_cols + ny);
+			}
+		}
+	}
+}
+
+/** Plan from where the robot is now, reusing everything the earlier calls
+ *	found out. The path is walked down the costs to the goal, keeping the
+ *	same direction when two ways are as good so it doesn't zigzag
+ *	@param start the cell the robot is in
+ *	@param path (output) the moves from the start to the goal, in the same
+ *		form as AStar::compute
+ */
+void DStarLite::compute(vec &start, vector<MotionAction> &path)
+{
+	this->isComplete = false;
+	this->isImpossible = false;
+	this->nexpanded = 0;
+
+	const cspace_grid &cspace = *this->cspace;
+	int n_cols = cspace.n_cols;
+	int sx = (int)round(start(0));
+	int sy = (int)round(start(1));
+	int gx = (int)this->goal(0);
+	int gy = (int)this->goal(1);
+	if (!cspace.free(sx, sy) || !cspace.free(gx, gy))
+	{ // nothing can reach a cell the robot doesn't fit in
+		this->isImpossible = true;
+		return;
+	}
+
+	// moving the start lowers every heuristic by at most the distance moved,
+	// so raise every key by that much instead of redoing the open list
+	this->km += abs(sx - this->last_x) + abs(sy - this->last_y);
+	this->last_x = sx;
+	this->last_y = sy;
+	uint32_t start_key = (uint32_t)sx * n_cols + sy;
+	this->repair(start_key);
+	if (this->nodes[start_key].g == HUGE_VAL)
+	{
+		this->isImpossible = true;
+		return;
+	}
+
+	path.clear();
+	int x = sx;
+	int y = sy;
+	int last = -1;
+	size_t limit = this->nodes.size();
+	while (x != gx || y != gy)
+	{
+		const search_node &curr = this->nodes[(uint32_t)x * n_cols + y];
+		int best = -1;
+		double best_g = HUGE_VAL;
+		for (int i = 0; i < 4; i++)
+		{
+			int nx = x + move_dx[i];
+			int ny = y + move_dy[i];
+			if (!cspace.free(nx, ny))
+			{
+				continue;
+			}
+			double g = this->nodes[(uint32_t)nx * n_cols + ny].g;
+			if (g < best_g || (g == best_g && i == last))
+			{
+				best = i;
+				best_g = g;
+			}
+		}
+		if (best < 0 || !(best_g < curr.g) || path.size() >= limit)
+		{ // can't happen once the start is settled, but don't loop forever
+			this->isImpossible = true;
+			return;
+		}
+		// the move into this cell, going backward from the goal like AStar
+		MotionAction action(x, y, (enum ActionId)(MOVE_FORWARD + (best ^ 1)));
+		action.cost = 1;
+		action.gcost = curr.g;
+		path.push_back(action);
+		x += move_dx[best];
+		y += move_dy[best];
+		last = best;
+	}
+	path.push_back(MotionAction(gx, gy, STARTING_ACTION));
+	this->isComplete = true;
+}
+
+/** Return whether or not the goal is impossible to reach
+ *  @return true if it is impossible, false otherwise
+ */
+bool DStarLite::impossible(void)
+{
+	return this->isImpossible;
+}
+
+/** Return whether or not the goal has been reached
+ *  @return true if goal is reached, false otherwise
+ */
+bool DStarLite::complete(void)
+{
+	return this->isComplete;
+}
@@ -0,0 +1,66 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#ifndef DSTAR_H
+#define DSTAR_H
+
+#include <armadillo>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "actions.h"
+#include "cspace.h"
+#include "heap.h"
+#include "integral.h"
+
+/** D* Lite: a planner that keeps its search between calls
+ *	Like AStar it searches backward from the goal, but the costs to the goal
+ *	stay around, so when the robot moves only the cells whose cost could have
+ *	changed get looked at again, and when the map changes only the cells
+ *	around the change do. The first compute costs about what AStar does, the
+ *	ones after it are close to free. Moves are 4 connected and cost 1 each
+ */
+class DStarLite
+{
+	public:
+		DStarLite(arma::mat map, arma::vec &goal);
+		DStarLite(std::shared_ptr<const cspace_grid> cspace, arma::vec &goal);
+		~DStarLite(void);
+		void set_goal(arma::vec &goal);
+		void update_map(std::shared_ptr<const cspace_grid> cspace);
+		void compute(arma::vec &start, std::vector<MotionAction> &path);
+		bool complete(void);
+		bool impossible(void);
+
+		arma::vec goal;
+		std::shared_ptr<const cspace_grid> cspace; // of the (transposed) map, where the footprint fits
+		int nexpanded; // nodes taken off the open list by the last compute
+
+		// stuff for the decision making capability
+		bool isComplete;
+		bool isImpossible;
+
+	private:
+		/** What the search knows about one cell
+		 */
+		struct search_node
+		{
+			double g; // cost to the goal, as of the last time it was expanded
+			double rhs; // one step lookahead of g through the best neighbor
+		};
+
+		void reset(void);
+		double key(uint32_t key) const;
+		double lookahead(uint32_t key) const;
+		void update_node(uint32_t key);
+		void repair(uint32_t start_key);
+
+		std::vector<search_node> nodes; // one per cell, key = x * n_cols + y
+		indexed_heap opened; // the cells whose g and rhs disagree
+		int last_x; // the start the keys in opened were made for
+		int last_y;
+		double km; // how far the start has moved since the search began
+};
+
+#endif
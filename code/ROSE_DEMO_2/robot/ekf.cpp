@@ -0,0 +1,278 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#include <cmath>
+
+#include "ekf.h"
+#include "rng.h"
+
+using namespace std;
+
+static inline double wrap180(double x)
+{
+	return x - 360.0 * floor((x + 180.0) / 360.0);
+}
+
+/** This is the default constructor
+ */
+ekf::ekf(void) :
+	x(0), y(0), t(0), vs(0.1), ws(0.2), range_sigma2(10.0), bearing_sigma2(5.0),
+	gate(9.21), nfailures(0), last_sighting(0)
+{
+	for (int i = 0; i < 9; i++)
+	{
+		P[i] = 0;
+	}
+}
+
+/** Constructor for the kalman filter, call reset to give it a pose
+ *	@param landmarks the landmarks by tag id, a list of sim_landmark converts
+ *		to this with every id valid
+ */
+ekf::ekf(const landmark_table &landmarks) : ekf()
+{
+	this->table = landmarks;
+}
+
+ekf::~ekf(void)
+{
+}
+
+/** Start tracking from a pose, usually the estimate of the particle filter
+ *	This also restarts the encoder reference, since the encoders kept
+ *	turning while the other backend was in charge
+ *	@param pose the pose and its covariance
+ */
+void ekf::reset(const pose_estimate &pose)
+{
+	this->x = pose.x;
+	this->y = pose.y;
+	this->t = wrap180(pose.t);
+	for (int i = 0; i < 9; i++)
+	{
+		this->P[i] = pose.cov[i];
+	}
+	this->nfailures = 0;
+	this->odometry.reset();
+}
+
+/** Use calibrated wheel constants for the odometry, this also restarts the
+ *	encoder reference
+ *	@param odometry the odometry model, see mecanum_odometry::load
+ */
+void ekf::set_odometry(const mecanum_odometry &odometry)
+{
+	this->odometry = odometry;
+	this->odometry.reset();
+}
+
+/** Set the motion noise, the same values as pfilter::set_noise
+ *	@param vs the velocity sigma2
+ *	@param ws the angular velocity sigma2
+ */
+void ekf::set_noise(double vs, double ws)
+{
+	this->vs = vs;
+	this->ws = ws;
+}
+
+/** Set the measurement noise of the landmark observations
+ *	@param range_sigma2 the variance of the range error
+ *	@param bearing_sigma2 the variance of the bearing error (degrees^2)
+ */
+void ekf::set_measurement_noise(double range_sigma2, double bearing_sigma2)
+{
+	this->range_sigma2 = range_sigma2;
+	this->bearing_sigma2 = bearing_sigma2;
+}
+
+/** Set the innovation gate
+ *	@param chi2 the largest squared mahalanobis distance of a sighting that
+ *		is still used, 9.21 keeps 99% of the good ones
+ */
+void ekf::set_gate(double chi2)
+{
+	this->gate = chi2;
+}
+
+/** Get the number of updates in a row where most of the sightings failed
+ *	the gate, a sign that the filter has lost track of the robot
+ *	@return the number of failed updates
+ */
+int ekf::failures(void) const
+{
+	return this->nfailures;
+}
+
+/** Propagate the pose through the motion model of basic_particle_set::move:
+ *	turn first, then go forward and sideways along the new heading. The
+ *	heading noise is scaled by the turn and the speed and slip noise by the
+ *	distance, so the covariance grows the same way the particle cloud does
+ *	@param sample the timestamped encoder reading
+ */
+void ekf::move(const odometry_sample &sample)
+{
+	odometry_twist twist;
+	if (!odometry.update(sample, twist))
+	{ // first, stale or repeated sample
+		return;
+	}
+	if (twist.vx == 0 && twist.vy == 0 && twist.w == 0)
+	{
+		return;
+	}
+
+	const double torad = M_PI / 180.0;
+	double vx = twist.vx;
+	double vy = twist.vy;
+	this->t = wrap180(this->t + twist.w);
+	double c = cos(this->t * torad);
+	double s = sin(this->t * torad);
+	this->x += vy * c + vx * s;
+	this->y += vy * s - vx * c;
+
+	// F = I except for how the heading swings the translation
+	double fx = (-vy * s + vx * c) * torad;
+	double fy = (vy * c + vx * s) * torad;
+
+	// P = F P F^T, written out since only the last column of F is nontrivial
+	double p02 = P[2] + fx * P[8];
+	double p12 = P[5] + fy * P[8];
+	double p00 = P[0] + 2 * fx * P[2] + fx * fx * P[8];
+	double p11 = P[4] + 2 * fy * P[5] + fy * fy * P[8];
+	double p01 = P[1] + fx * P[5] + fy * P[2] + fx * fy * P[8];
+
+	// Q: the heading noise goes through the same column, and the speed and
+	// slip noise are an orthonormal pair, so they add the same to x and y
+	double sigma_t = twist.w * this->ws * RNG_NOISE_SCALE;
+	double sigma_v = this->vs * RNG_NOISE_SCALE;
+	double var_t = sigma_t * sigma_t;
+	double var_v = (vx * vx + vy * vy) * sigma_v * sigma_v;
+	P[0] = p00 + var_t * fx * fx + var_v;
+	P[4] = p11 + var_t * fy * fy + var_v;
+	P[1] = P[3] = p01 + var_t * fx * fy;
+	P[2] = P[6] = p02 + var_t * fx;
+	P[5] = P[7] = p12 + var_t * fy;
+	P[8] += var_t;
+}
+
+/** Fold in one range and bearing sighting
+ *	@param range the measured range
+ *	@param bearing the measured bearing (degrees)
+ *	@param lx the x of the landmark
+ *	@param ly the y of the landmark
+ *	@return false if the sighting failed the gate
+ */
+bool ekf::update(double range, double bearing, double lx, double ly)
+{
+	const double todeg = 180.0 / M_PI;
+	double dx = lx - this->x;
+	double dy = ly - this->y;
+	double q = dx * dx + dy * dy;
+	if (q < 1e-6)
+	{ // on top of the tag, the bearing means nothing
+		return true;
+	}
+	double r = sqrt(q);
+	double v[2] = { range - r, wrap180(bearing - (atan2(dy, dx) * todeg - this->t)) };
+	double H[2][3] = {
+		{ -dx / r, -dy / r, 0 },
+		{ dy / q * todeg, -dx / q * todeg, -1 }
+	};
+
+	// PH = P H^T (3x2), S = H P H^T + R (2x2)
+	double PH[3][2];
+	for (int i = 0; i < 3; i++)
+	{
+		for (int k = 0; k < 2; k++)
+		{
+			PH[i][k] = P[i * 3 + 0] * H[k][0] + P[i * 3 + 1] * H[k][1] + P[i * 3 + 2] * H[k][2];
+		}
+	}
+	double s00 = H[0][0] * PH[0][0] + H[0][1] * PH[1][0] + H[0][2] * PH[2][0] + this->range_sigma2;
+	double s01 = H[0][0] * PH[0][1] + H[0][1] * PH[1][1] + H[0][2] * PH[2][1];
+	double s11 = H[1][0] * PH[0][1] + H[1][1] * PH[1][1] + H[1][2] * PH[2][1] + this->bearing_sigma2;
+	double det = s00 * s11 - s01 * s01;
+	if (!(det > 0))
+	{
+		return false;
+	}
+	double i00 = s11 / det;
+	double i01 = -s01 / det;
+	double i11 = s00 / det;
+
+	// gate on the squared mahalanobis distance of the innovation
+	double d2 = v[0] * (i00 * v[0] + i01 * v[1]) + v[1] * (i01 * v[0] + i11 * v[1]);
+	if (d2 > this->gate)
+	{
+		return false;
+	}
+
+	// K = PH S^-1, and since K S = PH, P - K S K^T = P - K PH^T
+	double K[3][2];
+	for (int i = 0; i < 3; i++)
+	{
+		K[i][0] = PH[i][0] * i00 + PH[i][1] * i01;
+		K[i][1] = PH[i][0] * i01 + PH[i][1] * i11;
+	}
+	this->x += K[0][0] * v[0] + K[0][1] * v[1];
+	this->y += K[1][0] * v[0] + K[1][1] * v[1];
+	this->t = wrap180(this->t + K[2][0] * v[0] + K[2][1] * v[1]);
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = i; j < 3; j++)
+		{
+			double p = P[i * 3 + j] - (K[i][0] * PH[j][0] + K[i][1] * PH[j][1]);
+			P[i * 3 + j] = p;
+			P[j * 3 + i] = p;
+		}
+	}
+	return true;
+}
+
+/** Fold in every tag that was seen, one at a time
+ *	An update where more than half the usable sightings fail the gate
+ *	counts as a failure, and any update where most of them pass clears
+ *	the count
+ *	@param observations the tags that were seen this update
+ */
+void ekf::observe(const vector<tag_observation> &observations)
+{
+	int used = 0;
+	int rejected = 0;
+	double newest = this->last_sighting;
+	for (const tag_observation &obs : observations)
+	{
+		// sightings no newer than ones already used are the same camera frame
+		if (!table.contains(obs.id) || (obs.timestamp > 0 && obs.timestamp <= this->last_sighting))
+		{
+			continue;
+		}
+		newest = (obs.timestamp > newest) ? obs.timestamp : newest;
+		used++;
+		if (!update(obs.range, obs.bearing, table.x[obs.id], table.y[obs.id]))
+		{
+			rejected++;
+		}
+	}
+	this->last_sighting = newest;
+	if (used == 0)
+	{ // nothing to judge the track by
+		return;
+	}
+	this->nfailures = (2 * rejected > used) ? this->nfailures + 1 : 0;
+}
+
+/** Get the pose and its covariance
+ *	@param pose (output) the pose estimate
+ */
+void ekf::estimate(pose_estimate &pose)
+{
+	pose.x = this->x;
+	pose.y = this->y;
+	pose.t = this->t;
+	for (int i = 0; i < 9; i++)
+	{
+		pose.cov[i] = this->P[i];
+	}
+}
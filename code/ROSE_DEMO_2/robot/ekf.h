@@ -0,0 +1,58 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#ifndef EKF_H
+#define EKF_H
+
+#include <vector>
+
+#include "landmark_table.h"
+#include "localizer.h"
+#include "odometry.h"
+#include "pose.h"
+#include "sim_landmark.h"
+
+/** An extended Kalman filter over ( x, y, theta ), theta in degrees
+ *	It uses the same motion model as the particles and the same range and
+ *	bearing model as pfilter::weigh, but carries a single gaussian, so an
+ *	update costs a few dozen flops per tag instead of a pass over every
+ *	particle. It can only track, not find the robot, so it is meant to take
+ *	over once the particle filter has converged. Sightings whose innovation
+ *	is too unlikely are gated out, and failures() counts how many updates in
+ *	a row lost most of their sightings that way
+ */
+class ekf : public localizer
+{
+	public:
+		ekf(void);
+		ekf(const landmark_table &landmarks);
+		~ekf(void);
+		void move(const odometry_sample &sample);
+		void observe(const std::vector<tag_observation> &observations);
+		void estimate(pose_estimate &pose);
+		void reset(const pose_estimate &pose);
+		void set_odometry(const mecanum_odometry &odometry);
+		void set_noise(double vs, double ws);
+		void set_measurement_noise(double range_sigma2, double bearing_sigma2);
+		void set_gate(double chi2);
+		int failures(void) const;
+
+	private:
+		bool update(double range, double bearing, double lx, double ly);
+
+		double x;
+		double y;
+		double t;
+		double P[9]; // row major covariance of ( x, y, t )
+		double vs; // speed sigma, a fraction of the distance moved
+		double ws; // heading sigma, a fraction of the turn
+		double range_sigma2;
+		double bearing_sigma2;
+		double gate; // chi2 bound on the innovation, 2 degrees of freedom
+		int nfailures;
+		double last_sighting; // timestamp of the newest sighting used so far
+		landmark_table table;
+		mecanum_odometry odometry;
+};
+
+#endif
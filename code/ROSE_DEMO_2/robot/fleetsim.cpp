@@ -0,0 +1,384 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+// Runs a fleet of simulated robots in one process. Every robot has its own
+// particle filter, planner and simulated base, and they all share one
+// read-only map, landmark table, visibility table and planner configuration
+// space. Each frame, every robot plans if it needs to, drives toward its
+// next waypoint, reads its encoders and tags, and updates its filter. The
+// robots are spread over a work stealing pool, since a robot that plans
+// costs far more than one that only localizes
+//
+//	usage: fleetsim <map image> [-r robots] [-t threads] [-f frames] [-n particles] [-s seed] [-m astar|jps]
+//
+// It reports the frame rate, the per robot cost of each stage and the
+// localization error, for sizing servers and for seeing how the planners
+// get along when many of them run at once. The robots don't see each
+// other, only the walls
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "astar.h"
+#include "pfilter.h"
+#include "sim_robot.h"
+#include "visibility.h"
+
+using namespace arma;
+using namespace std;
+
+typedef chrono::steady_clock fleet_clock;
+
+static const double speed = 2.0; // map cells per frame
+static const double dt = 0.05; // seconds per frame
+static const double max_range = 250;
+static const double fov = 60; // half angle, degrees
+static const int replan_frames = 100; // plan again this often, even on track
+
+static double wrap180(double x)
+{
+	return x - 360.0 * floor((x + 180.0) / 360.0);
+}
+
+static double elapsed_us(fleet_clock::time_point a, fleet_clock::time_point b)
+{
+	return chrono::duration<double, micro>(b - a).count();
+}
+
+/** What every robot reads and nobody writes
+ */
+struct fleet_world
+{
+	sim_map map;
+	vector<sim_landmark> landmarks; // for the simulated camera
+	shared_ptr<const landmark_table> table; // the same, for the filters
+	landmark_visibility visibility;
+	shared_ptr<const cspace_grid> cspace; // of the transposed map, for AStar
+	mecanum_odometry model;
+};
+
+/** One robot: the simulated base is the truth, the rest is what would run
+ *	on the robot
+ */
+struct fleet_robot
+{
+	sim_robot base;
+	pfilter pf;
+	rng random;
+	double enc[4];
+	int frame;
+	shared_ptr<AStar> planner; // keeps its search memory between plans
+	vector<MotionAction> path;
+	int waypoint;
+	int plan_age;
+	vec goal;
+
+	// what it cost and how well it did
+	vector<double> plan_us;
+	vector<double> localize_us;
+	int nplans;
+	int nfailed;
+	int nerror;
+	double sumsq_pos;
+	double sumsq_t;
+};
+
+/** Check that the planner's footprint fits at a cell
+ */
+static bool feasible(const fleet_world &world, int x, int y)
+{
+	return world.cspace->free(x, y);
+}
+
+/** Pick a random open spot that the planner can reach
+ */
+static bool pick_spot(const fleet_world &world, rng &random, double &x, double &y)
+{
+	for (int tries = 0; tries < 1000; tries++)
+	{
+		if (world.map.sample_free(random, x, y) && feasible(world, (int)round(x), (int)round(y)))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/** Plan from where the robot thinks it is to a new or the same goal
+ */
+static void plan(const fleet_world &world, fleet_robot &robot, const pose_estimate &pose, bool new_goal)
+{
+	fleet_clock::time_point t0 = fleet_clock::now();
+	vec start({ round(pose.x), round(pose.y) });
+	robot.path.clear();
+	robot.waypoint = 0;
+	robot.plan_age = 0;
+	double gx, gy;
+	if (new_goal && pick_spot(world, robot.random, gx, gy))
+	{ // if no spot turns up, keep heading for the old goal
+		robot.goal = vec({ round(gx), round(gy) });
+		robot.planner->set_goal(robot.goal);
+	}
+	robot.planner->compute(start, robot.path);
+	if (robot.planner->impossible())
+	{
+		robot.path.clear();
+	}
+	robot.nplans++;
+	robot.nfailed += robot.path.empty() ? 1 : 0;
+	robot.plan_us.push_back(elapsed_us(t0, fleet_clock::now()));
+}
+
+/** Run one frame of one robot
+ */
+static void step(const fleet_world &world, fleet_robot &robot)
+{
+	pose_estimate pose;
+	robot.pf.estimate(pose);
+
+	// plan when there's no path, the goal was reached, or the path is old
+	bool arrived = !robot.path.empty() && robot.waypoint >= (int)robot.path.size() - 1;
+	if (robot.path.empty() || arrived || robot.plan_age >= replan_frames)
+	{
+		plan(world, robot, pose, robot.path.empty() || arrived);
+	}
+	robot.plan_age++;
+
+	// drive toward a waypoint a little way down the path, the base is
+	// holonomic so there's no need to turn toward it
+	double vx = 0, vy = 0;
+	if (!robot.path.empty())
+	{
+		while (robot.waypoint < (int)robot.path.size() - 1 &&
+			hypot(robot.path[robot.waypoint].x - pose.x, robot.path[robot.waypoint].y - pose.y) < 2 * speed)
+		{
+			robot.waypoint++;
+		}
+		double dx = robot.path[robot.waypoint].x - pose.x;
+		double dy = robot.path[robot.waypoint].y - pose.y;
+		double d = hypot(dx, dy);
+		double k = (d > speed) ? speed / d : 1;
+		double c = cos(pose.t * M_PI / 180.0);
+		double s = sin(pose.t * M_PI / 180.0);
+		vy = (dx * c + dy * s) * k; // forward
+		vx = (dx * s - dy * c) * k; // to the right
+	}
+	robot.base.move(vx, vy, 0);
+
+	// the wheel travel that makes that twist, see mecanum_odometry
+	double f = vy / world.model.k_forward;
+	double r = vx / world.model.k_strafe;
+	double ticks[4] = { f + r, f - r, f - r, f + r };
+
+	odometry_sample sample;
+	sample.timestamp = ++robot.frame * dt;
+	for (int i = 0; i < 4; i++)
+	{
+		robot.enc[i] += ticks[i] * (1 + robot.random.gaussian(0.02));
+		sample.enc[i] = robot.enc[i];
+	}
+	vector<tag_observation> tags;
+	double x = robot.base.x, y = robot.base.y, t = robot.base.t;
+	for (int id = 0; id < (int)world.landmarks.size(); id++)
+	{
+		double dx = world.landmarks[id].x - x;
+		double dy = world.landmarks[id].y - y;
+		double range = sqrt(dx * dx + dy * dy);
+		double bearing = wrap180(atan2(dy, dx) * 180.0 / M_PI - t);
+		if (range > max_range || fabs(bearing) > fov || !world.visibility.visible((int)round(x), (int)round(y), id))
+		{
+			continue;
+		}
+		tag_observation obs = { id, range + robot.random.gaussian(2.0), bearing + robot.random.gaussian(2.0), sample.timestamp };
+		tags.push_back(obs);
+	}
+	fleet_clock::time_point t0 = fleet_clock::now();
+	robot.pf.move(sample);
+	robot.pf.observe(tags);
+	robot.pf.estimate(pose);
+	robot.localize_us.push_back(elapsed_us(t0, fleet_clock::now()));
+
+	double ex = pose.x - x;
+	double ey = pose.y - y;
+	double et = wrap180(pose.t - t);
+	robot.nerror++;
+	robot.sumsq_pos += ex * ex + ey * ey;
+	robot.sumsq_t += et * et;
+}
+
+static double percentile(vector<double> &us, double p)
+{
+	if (us.empty())
+	{
+		return 0;
+	}
+	int k = (int)ceil(p / 100.0 * us.size()) - 1;
+	k = (k < 0) ? 0 : k;
+	nth_element(us.begin(), us.begin() + k, us.end());
+	return us[k];
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		printf("usage: %s <map image> [-r robots] [-t threads] [-f frames] [-n particles] [-s seed] [-m astar|jps]\n", argv[0]);
+		return 1;
+	}
+	int nrobots = 16;
+	int nthreads = (int)thread::hardware_concurrency();
+	int nframes = 500;
+	int nparticles = 500;
+	uint64_t seed = 0;
+	enum SearchMode mode = SEARCH_ASTAR;
+	for (int i = 2; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "-r") == 0)
+		{
+			nrobots = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-t") == 0)
+		{
+			nthreads = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-f") == 0)
+		{
+			nframes = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-n") == 0)
+		{
+			nparticles = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-s") == 0)
+		{
+			seed = strtoull(argv[i + 1], NULL, 10);
+		}
+		else if (strcmp(argv[i], "-m") == 0)
+		{
+			mode = (strcmp(argv[i + 1], "jps") == 0) ? SEARCH_JPS : SEARCH_ASTAR;
+		}
+	}
+	nthreads = (nthreads < 1) ? 1 : nthreads;
+
+	// STEP 1: the shared world, built once
+	fleet_world world;
+	world.map.load(argv[1]);
+	if (world.map.free_cells.empty())
+	{
+		printf("could not load %s\n", argv[1]);
+		return 1;
+	}
+	world.landmarks = hallway_landmarks();
+	workpool pool(nthreads);
+	world.table = make_shared<const landmark_table>(world.landmarks);
+	world.visibility.build(world.map, *world.table, pool);
+	integral_image occupancy;
+	occupancy.build(world.map.map.t());
+	shared_ptr<cspace_grid> cspace = make_shared<cspace_grid>();
+	cspace->build(occupancy, ASTAR_CLEARANCE);
+	world.cspace = cspace;
+
+	// STEP 2: the robots, each dropped somewhere the planner can start from,
+	// with a filter that knows roughly where
+	rng placer(seed);
+	vector<fleet_robot> robots(nrobots);
+	for (int i = 0; i < nrobots; i++)
+	{
+		fleet_robot &robot = robots[i];
+		double x, y;
+		if (!pick_spot(world, placer, x, y))
+		{
+			printf("no room for the planner's footprint on %s\n", argv[1]);
+			return 1;
+		}
+		double t = placer.uniform() * 360.0 - 180.0;
+		robot.goal = vec({ round(x), round(y) });
+		robot.planner = make_shared<AStar>(world.cspace, robot.goal, mode);
+		robot.base = sim_robot(&world.map, seed + 2000003 * (i + 1));
+		robot.base.set_size(10);
+		robot.base.set_noise(0.02, 0.02);
+		robot.base.set_pose(x, y, t);
+		robot.pf = pfilter(nparticles, &world.map, world.table, x, y, t, 20, seed + 1 + i, 1);
+		robot.pf.set_noise(0.1, 0.2);
+		robot.pf.set_recovery(0.001, 0.1);
+		robot.pf.set_visibility(&world.visibility);
+		robot.random = rng(seed + 1000003 * (i + 1));
+		std::fill(robot.enc, robot.enc + 4, 0.0);
+		robot.frame = 0;
+		robot.waypoint = 0;
+		robot.plan_age = 0;
+		robot.nplans = 0;
+		robot.nfailed = 0;
+		robot.nerror = 0;
+		robot.sumsq_pos = 0;
+		robot.sumsq_t = 0;
+		robot.plan_us.reserve(nframes);
+		robot.localize_us.reserve(nframes);
+	}
+
+	// STEP 3: run the frames, every robot is independent within a frame
+	vector<double> frame_us;
+	frame_us.reserve(nframes);
+	fleet_clock::time_point start = fleet_clock::now();
+	for (int k = 0; k < nframes; k++)
+	{
+		fleet_clock::time_point t0 = fleet_clock::now();
+		pool.run_stealing(nrobots, [&](int /*worker*/, int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				step(world, robots[i]);
+			}
+		});
+		frame_us.push_back(elapsed_us(t0, fleet_clock::now()));
+	}
+	double seconds = chrono::duration<double>(fleet_clock::now() - start).count();
+
+	// STEP 4: report
+	vector<double> plan_us;
+	vector<double> localize_us;
+	int nplans = 0, nfailed = 0, nerror = 0;
+	double sumsq_pos = 0, sumsq_t = 0;
+	for (fleet_robot &robot : robots)
+	{
+		plan_us.insert(plan_us.end(), robot.plan_us.begin(), robot.plan_us.end());
+		localize_us.insert(localize_us.end(), robot.localize_us.begin(), robot.localize_us.end());
+		nplans += robot.nplans;
+		nfailed += robot.nfailed;
+		nerror += robot.nerror;
+		sumsq_pos += robot.sumsq_pos;
+		sumsq_t += robot.sumsq_t;
+	}
+	double plan_total = 0;
+	for (double us : plan_us)
+	{
+		plan_total += us;
+	}
+	double localize_total = 0;
+	for (double us : localize_us)
+	{
+		localize_total += us;
+	}
+	printf("%d robots, %d threads, %d frames of %d particles on %s, %s planner\n", nrobots, nthreads, nframes, nparticles, argv[1],
+		(mode == SEARCH_JPS) ? "jps" : "astar");
+	printf("frames/s %.1f (%.1f real time), robot updates/s %.0f\n",
+		nframes / seconds, nframes / seconds * dt, nframes * nrobots / seconds);
+	printf("frame     p50 %9.1f us  p99 %9.1f us\n", percentile(frame_us, 50), percentile(frame_us, 99));
+	printf("localize  p50 %9.1f us  p99 %9.1f us  total %7.3f s\n",
+		percentile(localize_us, 50), percentile(localize_us, 99), localize_total / 1e6);
+	printf("plan      p50 %9.1f us  p99 %9.1f us  total %7.3f s  (%d plans, %d failed)\n",
+		percentile(plan_us, 50), percentile(plan_us, 99), plan_total / 1e6, nplans, nfailed);
+	if (nerror > 0)
+	{
+		printf("rms pos %.3f  rms deg %.3f\n", sqrt(sumsq_pos / nerror), sqrt(sumsq_t / nerror));
+	}
+	return 0;
+}
@@ -4,31 +4,266 @@
 #ifndef HEAP_H
 #define HEAP_H
 
+#include <cstddef>
 #include <stdexcept>
 #include <vector>
 
-// for now, also include heap.cpp
-// will fix later
-
-template <class T>
-class Heap
+/** A min heap of integer keys (node indices) with double priorities
+ *	Every key is in the heap at most once and the heap knows where each one
+ *	sits, so a key's priority can be lowered in place instead of pushing a
+ *	duplicate. It is 4-ary: the tree is half as deep as a binary one and the
+ *	four children of a node sit next to each other in memory, which pays off
+ *	for the push heavy, decrease-key heavy searches it is meant for. Entries
+ *	are two words, so moving them around never copies anything big
+ */
+class indexed_heap
 {
 	public:
-		Heap(void);
-		~Heap(void);
-		void siftup(void);
-		void siftdown(void);
-		void push(T const &item, int priority);
-		T pop(void);
-		bool empty(void) const;
-		size_t size(void) const;
+		indexed_heap(int nkeys = 0)
+		{
+			this->reserve(nkeys);
+		}
+
+		~indexed_heap(void)
+		{
+		}
+
+		/** Make room for keys in [0, nkeys), so that pushing them won't
+		 *	allocate
+		 *	@param nkeys one past the largest key
+		 */
+		void reserve(int nkeys)
+		{
+			if (nkeys > (int)this->position.size())
+			{
+				this->position.resize(nkeys, -1);
+			}
+			this->heap.reserve(nkeys);
+		}
+
+		/** Take everything out, this only touches the keys that were left in
+		 */
+		void clear(void)
+		{
+			for (const entry &e : this->heap)
+			{
+				this->position[e.key] = -1;
+			}
+			this->heap.clear();
+		}
+
+		bool empty(void) const
+		{
+			return this->heap.empty();
+		}
+
+		size_t size(void) const
+		{
+			return this->heap.size();
+		}
+
+		bool contains(int key) const
+		{
+			return key >= 0 && key < (int)this->position.size() && this->position[key] >= 0;
+		}
+
+		/** Get the priority of a key that is in the heap
+		 *	@param key the key
+		 *	@return the priority
+		 */
+		double priority(int key) const
+		{
+			return this->heap[this->position[key]].priority;
+		}
+
+		/** Put a key in, or change its priority if it is already in
+		 *	@param key the key, a non-negative index
+		 *	@param priority the priority, lower comes out first
+		 */
+		void push(int key, double priority)
+		{
+			if (key >= (int)this->position.size())
+			{
+				this->position.resize(key + 1, -1);
+			}
+			int i = this->position[key];
+			if (i < 0)
+			{
+				i = (int)this->heap.size();
+				entry e = { priority, key };
+				this->heap.push_back(e);
+				this->position[key] = i;
+				this->sift_up(i);
+			}
+			else if (priority < this->heap[i].priority)
+			{
+				this->heap[i].priority = priority;
+				this->sift_up(i);
+			}
+			else
+			{
+				this->heap[i].priority = priority;
+				this->sift_down(i);
+			}
+		}
+
+		/** Lower the priority of a key that is in the heap
+		 *	@param key the key
+		 *	@param priority the new priority
+		 *	@return false if the key isn't in the heap or the priority
+		 *		isn't lower
+		 */
+		bool decrease(int key, double priority)
+		{
+			if (!this->contains(key))
+			{
+				return false;
+			}
+			int i = this->position[key];
+			if (!(priority < this->heap[i].priority))
+			{
+				return false;
+			}
+			this->heap[i].priority = priority;
+			this->sift_up(i);
+			return true;
+		}
+
+		/** Get the key with the lowest priority, without taking it out
+		 *	@return the key
+		 */
+		int top(void) const
+		{
+			if (this->heap.empty())
+			{
+				throw std::out_of_range("indexed_heap::top(): empty heap");
+			}
+			return this->heap[0].key;
+		}
+
+		/** Get the lowest priority, without taking anything out
+		 *	@return the priority
+		 */
+		double top_priority(void) const
+		{
+			if (this->heap.empty())
+			{
+				throw std::out_of_range("indexed_heap::top_priority(): empty heap");
+			}
+			return this->heap[0].priority;
+		}
+
+		/** Take a key out from anywhere in the heap
+		 *	@param key the key, nothing happens if it isn't in
+		 */
+		void erase(int key)
+		{
+			if (!this->contains(key))
+			{
+				return;
+			}
+			int i = this->position[key];
+			double removed = this->heap[i].priority;
+			this->position[key] = -1;
+			entry last = this->heap.back();
+			this->heap.pop_back();
+			if (i < (int)this->heap.size())
+			{
+				this->heap[i] = last;
+				this->position[last.key] = i;
+				if (last.priority < removed)
+				{
+					this->sift_up(i);
+				}
+				else
+				{
+					this->sift_down(i);
+				}
+			}
+		}
+
+		/** Take out the key with the lowest priority
+		 *	@return the key
+		 */
+		int pop(void)
+		{
+			if (this->heap.empty())
+			{
+				throw std::out_of_range("indexed_heap::pop(): empty heap");
+			}
+			int key = this->heap[0].key;
+			this->position[key] = -1;
+			entry last = this->heap.back();
+			this->heap.pop_back();
+			if (!this->heap.empty())
+			{
+				this->heap[0] = last;
+				this->position[last.key] = 0;
+				this->sift_down(0);
+			}
+			return key;
+		}
 
 	private:
-		void swap(int const &a, int const &b);
-		std::vector<T> queue;
-		std::vector<int> priorities;
-		int parent(int index) const;
-		int lchild(int index) const;
-		int rchild(int index) const;
+		struct entry
+		{
+			double priority;
+			int key;
+		};
+
+		// move the hole up instead of swapping, so each level is one write
+		void sift_up(int i)
+		{
+			entry e = this->heap[i];
+			while (i > 0)
+			{
+				int p = (i - 1) >> 2;
+				if (!(e.priority < this->heap[p].priority))
+				{
+					break;
+				}
+				this->heap[i] = this->heap[p];
+				this->position[this->heap[i].key] = i;
+				i = p;
+			}
+			this->heap[i] = e;
+			this->position[e.key] = i;
+		}
+
+		void sift_down(int i)
+		{
+			int n = (int)this->heap.size();
+			entry e = this->heap[i];
+			while (true)
+			{
+				int first = (i << 2) + 1;
+				if (first >= n)
+				{
+					break;
+				}
+				int last = (first + 4 < n) ? first + 4 : n;
+				int best = first;
+				for (int c = first + 1; c < last; c++)
+				{
+					if (this->heap[c].priority < this->heap[best].priority)
+					{
+						best = c;
+					}
+				}
+				if (!(this->heap[best].priority < e.priority))
+				{
+					break;
+				}
+				this->heap[i] = this->heap[best];
+				this->position[this->heap[i].key] = i;
+				i = best;
+			}
+			this->heap[i] = e;
+			this->position[e.key] = i;
+		}
+
+		std::vector<entry> heap;
+		std::vector<int> position; // heap slot of each key, -1 if it isn't in
 };
-#endif
\ No newline at end of file
+
+#endif
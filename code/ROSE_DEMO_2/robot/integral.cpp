@@ -0,0 +1,61 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#include "integral.h"
+
+using namespace arma;
+
+integral_image::integral_image(void) :
+	n_rows(0), n_cols(0)
+{
+}
+
+integral_image::~integral_image(void)
+{
+}
+
+/** Sum up the grid, where a cell is occupied if it is over 0.5
+ *	@param grid the grid
+ */
+void integral_image::build(const mat &grid)
+{
+	this->n_rows = (int)grid.n_rows;
+	this->n_cols = (int)grid.n_cols;
+	int stride = this->n_cols + 1;
+	this->sums.assign((size_t)(this->n_rows + 1) * stride, 0);
+	for (int i = 0; i < this->n_rows; i++)
+	{
+		uint32_t rowsum = 0;
+		const uint32_t *above = this->sums.data() + (size_t)i * stride;
+		uint32_t *here = this->sums.data() + (size_t)(i + 1) * stride;
+		for (int j = 0; j < this->n_cols; j++)
+		{
+			rowsum += grid(i, j) > 0.5;
+			here[j + 1] = above[j + 1] + rowsum;
+		}
+	}
+}
+
+/** Count the occupied cells in a rectangle, the parts of the rectangle
+ *	that are off the grid count as empty
+ *	@param top the first row
+ *	@param left the first column
+ *	@param bottom the last row (inclusive)
+ *	@param right the last column (inclusive)
+ *	@return the number of occupied cells
+ */
+uint32_t integral_image::count(int top, int left, int bottom, int right) const
+{
+	top = (top < 0) ? 0 : top;
+	left = (left < 0) ? 0 : left;
+	bottom = (bottom >= this->n_rows) ? this->n_rows - 1 : bottom;
+	right = (right >= this->n_cols) ? this->n_cols - 1 : right;
+	if (top > bottom || left > right)
+	{
+		return 0;
+	}
+	int stride = this->n_cols + 1;
+	const uint32_t *s = this->sums.data();
+	return s[(size_t)(bottom + 1) * stride + right + 1] - s[(size_t)top * stride + right + 1]
+		- s[(size_t)(bottom + 1) * stride + left] + s[(size_t)top * stride + left];
+}
@@ -0,0 +1,32 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#ifndef INTEGRAL_H
+#define INTEGRAL_H
+
+#include <armadillo>
+#include <cstdint>
+#include <vector>
+
+/** Summed area table of the occupied cells of a grid
+ *	Once built, the number of occupied cells in any rectangle takes four
+ *	lookups, no matter how big the rectangle is
+ */
+class integral_image
+{
+	public:
+		integral_image(void);
+		~integral_image(void);
+		void build(const arma::mat &grid);
+		uint32_t count(int top, int left, int bottom, int right) const;
+
+		int n_rows;
+		int n_cols;
+
+	private:
+		// (n_rows + 1) x (n_cols + 1), row major, sums[(i+1) * (n_cols+1) + (j+1)]
+		// is the number of occupied cells in grid(0..i, 0..j)
+		std::vector<uint32_t> sums;
+};
+
+#endif
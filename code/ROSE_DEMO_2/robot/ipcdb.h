@@ -10,6 +10,7 @@
 #include "chili_landmarks.h"
 #include "Rose.h"
 #include "pfilter.h"
+#include "pose_service.h"
 
 // for stopping the robot, no matter what
 static int stopsig;
@@ -17,7 +18,8 @@ static int stopsig;
 // for markers
 static chili_landmarks chili;
 static std::mutex chili_lock;
-static arma::mat chilitags(3, 20, arma::fill::zeros);
+static arma::mat chilitags(3, 20, arma::fill::zeros); // for display
+static std::vector<tag_observation> chiliobs; // every tag that is in view
 
 // for sending motion to the robot
 static Rose rose;
@@ -31,10 +33,12 @@ static bool manual_confirmed;
 // for getting the position and map
 static std::mutex pose_lock;
 static arma::vec robot_pose(3, arma::fill::zeros); // x, y, theta
+static pose_service pose_server; // the pose carried forward to when it is asked for
 static pfilter pf; // !! takes a long time to blit
 static std::mutex map_lock;
 static sim_map globalmap;
 static std::vector<sim_landmark> landmarks;
+static landmark_visibility visibility; // which tags each cell can see
 
 // for getting the planned path
 static std::mutex path_lock;
@@ -0,0 +1,136 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#include <cmath>
+
+#include "kld.h"
+#include "mathfun.h"
+
+using namespace std;
+
+kld_sampler::kld_sampler(void) :
+	nmin(0), nmax(0), binsize(1), binangle(1), epsilon(0.05), z(2.326), generation(0)
+{
+}
+
+/** Set up the sampler
+ *	@param nmin the least number of particles to keep
+ *	@param nmax the most number of particles to keep
+ *	@param binsize the bin width for x and y
+ *	@param binangle the bin width for theta (degrees)
+ *	@param epsilon the max KL divergence
+ *	@param z the upper 1 - delta quantile of the standard normal (2.326 for delta = 0.01)
+ */
+kld_sampler::kld_sampler(int nmin, int nmax, double binsize, double binangle, double epsilon, double z) :
+	nmin(nmin), nmax(nmax), binsize(binsize), binangle(binangle), epsilon(epsilon), z(z), generation(0)
+{
+	int size = 1;
+	while (size < 2 * nmax)
+	{
+		size <<= 1;
+	}
+	this->keys.resize(size);
+	this->stamps.resize(size, 0);
+}
+
+kld_sampler::~kld_sampler(void)
+{
+}
+
+/** Count the occupied bins of the particles with nonzero weight, and
+ *	return the number of particles the next set should have
+ *	@param particles the weighted particle set
+ *	@return the particle count, within [nmin, nmax]
+ */
+template <typename T>
+int kld_sampler::count(const basic_particle_set<T> &particles)
+{
+	int N = particles.size();
+	if ((int)this->keys.size() < 2 * N)
+	{ // only when the set is bigger than nmax
+		int size = (int)this->keys.size() ? (int)this->keys.size() : 1;
+		while (size < 2 * N)
+		{
+			size <<= 1;
+		}
+		this->keys.assign(size, 0);
+		this->stamps.assign(size, 0);
+		this->generation = 0;
+	}
+	if (++this->generation == 0)
+	{ // wrapped around, really clear the stamps
+		fill(this->stamps.begin(), this->stamps.end(), 0);
+		this->generation = 1;
+	}
+
+	int k = 0;
+	for (int i = 0; i < N; i++)
+	{
+		if (particles.w[i] <= 0)
+		{
+			continue;
+		}
+		// 21 bits per axis is plenty for a building sized map
+		uint64_t bx = (uint64_t)(int64_t)floor((double)particles.x[i] / this->binsize) & 0x1fffff;
+		uint64_t by = (uint64_t)(int64_t)floor((double)particles.y[i] / this->binsize) & 0x1fffff;
+		uint64_t bt = (uint64_t)(int64_t)floor(wrap_value(particles.t[i], 0, 360) / this->binangle) & 0x1fffff;
+		if (this->insert((bx << 42) | (by << 21) | bt))
+		{
+			k++;
+		}
+	}
+	return this->limit(k);
+}
+
+template int kld_sampler::count(const basic_particle_set<float> &particles);
+template int kld_sampler::count(const basic_particle_set<double> &particles);
+
+/** The KLD bound on the number of particles for k occupied bins
+ *	(Wilson-Hilferty approximation of the chi-square quantile)
+ *	@param k the number of occupied bins
+ *	@return the particle count, within [nmin, nmax]
+ */
+int kld_sampler::limit(int k) const
+{
+	if (k <= 1)
+	{
+		return this->nmin;
+	}
+	double a = 2.0 / (9.0 * (k - 1));
+	double b = 1.0 - a + sqrt(a) * this->z;
+	double n = (k - 1) / (2.0 * this->epsilon) * b * b * b;
+	if (n < this->nmin)
+	{
+		return this->nmin;
+	}
+	if (n > this->nmax)
+	{
+		return this->nmax;
+	}
+	return (int)ceil(n);
+}
+
+/** Insert a bin into the set
+ *	@param key the packed bin index
+ *	@return true if the bin was not occupied before
+ */
+bool kld_sampler::insert(uint64_t key)
+{
+	uint64_t mask = this->keys.size() - 1;
+	uint64_t slot = (key * 0x9e3779b97f4a7c15ULL) >> 20;
+	while (true)
+	{
+		slot &= mask;
+		if (this->stamps[slot] != this->generation)
+		{
+			this->stamps[slot] = this->generation;
+			this->keys[slot] = key;
+			return true;
+		}
+		if (this->keys[slot] == key)
+		{
+			return false;
+		}
+		slot++;
+	}
+}
@@ -0,0 +1,45 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#ifndef KLD_H
+#define KLD_H
+
+#include <cstdint>
+#include <vector>
+
+#include "particles.h"
+
+/** KLD-sampling (Fox, 2003) for choosing the particle count
+ *	The particles are dropped into (x, y, theta) bins, and the number of
+ *	occupied bins k sets how many particles are needed so that the error
+ *	between the sample and the true posterior stays under epsilon with
+ *	probability 1 - delta. A spread out cloud fills many bins and asks
+ *	for many particles, a tight cluster only a few
+ */
+class kld_sampler
+{
+	public:
+		kld_sampler(void);
+		kld_sampler(int nmin, int nmax, double binsize, double binangle, double epsilon = 0.05, double z = 2.326);
+		~kld_sampler(void);
+		template <typename T>
+		int count(const basic_particle_set<T> &particles);
+		int limit(int k) const;
+
+		int nmin;
+		int nmax;
+		double binsize; // bin width for x and y
+		double binangle; // bin width for theta, in degrees
+		double epsilon; // max KL divergence
+		double z; // upper 1 - delta quantile of the standard normal
+
+	private:
+		bool insert(uint64_t key);
+
+		// open addressing set of occupied bins, cleared by bumping the generation
+		std::vector<uint64_t> keys;
+		std::vector<uint32_t> stamps;
+		uint32_t generation;
+};
+
+#endif
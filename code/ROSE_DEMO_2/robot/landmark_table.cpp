@@ -0,0 +1,64 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#include "landmark_table.h"
+
+using namespace std;
+
+landmark_table::landmark_table(void)
+{
+}
+
+/** Build the table from a list of landmarks, where landmark i is tag i
+ *	@param landmarks the list of landmarks
+ */
+landmark_table::landmark_table(const vector<sim_landmark> &landmarks)
+{
+	for (int i = 0; i < (int)landmarks.size(); i++)
+	{
+		this->set(i, landmarks[i].x, landmarks[i].y);
+	}
+}
+
+landmark_table::~landmark_table(void)
+{
+}
+
+/** Place a landmark, growing the table if needed
+ *	@param id the tag id
+ *	@param x the x position on the map
+ *	@param y the y position on the map
+ */
+void landmark_table::set(int id, double x, double y)
+{
+	if (id < 0)
+	{
+		return;
+	}
+	if (id >= this->size())
+	{
+		this->x.resize(id + 1, 0);
+		this->y.resize(id + 1, 0);
+		this->valid.resize(id + 1, 0);
+	}
+	this->x[id] = x;
+	this->y[id] = y;
+	this->valid[id] = 1;
+}
+
+/** See whether a tag has a landmark
+ *	@param id the tag id
+ *	@return true if the tag is on the map
+ */
+bool landmark_table::contains(int id) const
+{
+	return id >= 0 && id < this->size() && this->valid[id];
+}
+
+/** Get the size of the table (one past the largest tag id)
+ *	@return the size
+ */
+int landmark_table::size(void) const
+{
+	return (int)this->valid.size();
+}
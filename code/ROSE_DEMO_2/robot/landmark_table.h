@@ -0,0 +1,31 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#ifndef LANDMARK_TABLE_H
+#define LANDMARK_TABLE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "sim_landmark.h"
+
+/** Landmark positions indexed directly by tag id
+ *	The positions live in flat arrays so that looking up a sighted tag is a
+ *	single index, no matter how many tags are in the building
+ */
+class landmark_table
+{
+	public:
+		landmark_table(void);
+		landmark_table(const std::vector<sim_landmark> &landmarks);
+		~landmark_table(void);
+		void set(int id, double x, double y);
+		bool contains(int id) const;
+		int size(void) const;
+
+		std::vector<double> x;
+		std::vector<double> y;
+		std::vector<uint8_t> valid;
+};
+
+#endif
@@ -0,0 +1,26 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#ifndef LOCALIZER_H
+#define LOCALIZER_H
+
+#include <vector>
+
+#include "odometry.h"
+#include "pose.h"
+#include "sim_landmark.h"
+
+/** What localize_pose needs from a localization backend: integrate the
+ *	encoders, fold in the tags that were seen, and report the pose
+ */
+class localizer
+{
+	public:
+		virtual ~localizer(void) {}
+		virtual void move(const odometry_sample &sample) = 0;
+		virtual void observe(const std::vector<tag_observation> &observations) = 0;
+		virtual void estimate(pose_estimate &pose) = 0;
+		virtual void reset(const pose_estimate &pose) = 0;
+};
+
+#endif
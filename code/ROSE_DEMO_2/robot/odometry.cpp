@@ -0,0 +1,109 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#include <cstdio>
+#include <fstream>
+#include <njson/json.hpp>
+#include <string>
+
+#include "odometry.h"
+
+using namespace std;
+using json = nlohmann::json;
+
+mecanum_odometry::mecanum_odometry(void) :
+	k_forward(0.246826621412), k_strafe(0.246826621412), k_rotation(2.2857123550422 / 2), started(false)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		this->wheel_scale[i] = 1;
+	}
+}
+
+mecanum_odometry::~mecanum_odometry(void)
+{
+}
+
+/** Load the wheel constants from the "odometry" section of a json file,
+ *	for example
+ *		"odometry": {
+ *			"k_forward": 0.2468, "k_strafe": 0.21, "k_rotation": 1.1429,
+ *			"wheel_scale": [1, 1, 1, 1]
+ *		}
+ *	Any constant that is missing keeps its current value
+ *	@param filename the json file
+ *	@return false if the file or the section can't be read
+ */
+bool mecanum_odometry::load(const string &filename)
+{
+	ifstream params_file(filename);
+	if (!params_file.is_open())
+	{
+		printf("Error: cannot find \"%s\", using the default odometry constants.\n", filename.c_str());
+		return false;
+	}
+	json cp = json::parse(params_file, nullptr, false);
+	if (cp.is_discarded() || !cp.is_object() || cp.find("odometry") == cp.end())
+	{
+		printf("Error: no odometry section in \"%s\", using the default odometry constants.\n", filename.c_str());
+		return false;
+	}
+	json odom = cp["odometry"];
+	if (odom.find("k_forward") != odom.end())
+	{
+		this->k_forward = odom["k_forward"];
+	}
+	if (odom.find("k_strafe") != odom.end())
+	{
+		this->k_strafe = odom["k_strafe"];
+	}
+	if (odom.find("k_rotation") != odom.end())
+	{
+		this->k_rotation = odom["k_rotation"];
+	}
+	if (odom.find("wheel_scale") != odom.end() && odom["wheel_scale"].size() == 4)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			this->wheel_scale[i] = odom["wheel_scale"][i];
+		}
+	}
+	return true;
+}
+
+/** Forget the last sample, so the next one only sets the reference
+ */
+void mecanum_odometry::reset(void)
+{
+	this->started = false;
+}
+
+/** Integrate a new encoder sample against the one before it
+ *	@param sample the timestamped encoder reading
+ *	@param twist (output) the motion since the last sample
+ *	@return false for the first sample, or one that is stale or repeated
+ */
+bool mecanum_odometry::update(const odometry_sample &sample, odometry_twist &twist)
+{
+	if (!this->started)
+	{
+		this->prev = sample;
+		this->started = true;
+		return false;
+	}
+	if (sample.timestamp <= this->prev.timestamp)
+	{
+		return false;
+	}
+	double d[4];
+	for (int i = 0; i < 4; i++)
+	{
+		d[i] = (sample.enc[i] - this->prev.enc[i]) * this->wheel_scale[i];
+	}
+	twist.dt = sample.timestamp - this->prev.timestamp;
+	twist.vy = (d[0] + d[1] + d[2] + d[3]) / 4 * this->k_forward;
+	twist.vx = (d[0] - d[1] - d[2] + d[3]) / 4 * this->k_strafe;
+	twist.w = (-d[0] + d[1] - d[2] + d[3]) / 4 * this->k_rotation;
+	this->prev = sample;
+	return true;
+}
@@ -0,0 +1,59 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#ifndef ODOMETRY_H
+#define ODOMETRY_H
+
+#include <string>
+
+/** One reading of the four wheel encoders
+ *	Wheel order matches Rose::encoder: front left, front right, back left,
+ *	back right
+ */
+struct odometry_sample
+{
+	double timestamp; // seconds
+	double enc[4];
+};
+
+/** How far the robot went between two encoder samples, in the robot's
+ *	frame, with the same convention as sim_robot::move
+ */
+struct odometry_twist
+{
+	double dt; // seconds
+	double vx; // sideways, to the right
+	double vy; // forward
+	double w; // counterclockwise, degrees
+};
+
+/** Mecanum forward kinematics for the base
+ *	With the rollers in an X, the wheel travels d0..d3 (front left, front
+ *	right, back left, back right) combine as
+ *		forward	= ( d0 + d1 + d2 + d3) / 4 * k_forward
+ *		right	= ( d0 - d1 - d2 + d3) / 4 * k_strafe
+ *		ccw		= (-d0 + d1 - d2 + d3) / 4 * k_rotation
+ *	which matches the wheel patterns manual_input drives with (w, d, q).
+ *	The defaults are the constants the filter has always used, and a
+ *	calibration can be loaded from the "odometry" section of a json file
+ */
+class mecanum_odometry
+{
+	public:
+		mecanum_odometry(void);
+		~mecanum_odometry(void);
+		bool load(const std::string &filename);
+		void reset(void);
+		bool update(const odometry_sample &sample, odometry_twist &twist);
+
+		double k_forward; // map units per encoder tick, driving forward
+		double k_strafe; // map units per encoder tick, strafing
+		double k_rotation; // degrees per encoder tick, turning in place
+		double wheel_scale[4]; // per wheel correction (wheel size, tick rate)
+
+	private:
+		bool started;
+		odometry_sample prev;
+};
+
+#endif
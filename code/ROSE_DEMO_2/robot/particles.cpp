@@ -0,0 +1,187 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#include <cmath>
+
+#include "particles.h"
+
+template <typename T>
+basic_particle_set<T>::basic_particle_set(void)
+{
+}
+
+template <typename T>
+basic_particle_set<T>::~basic_particle_set(void)
+{
+}
+
+/** Resize all of the arrays at once
+ *	@param n the number of particles
+ */
+template <typename T>
+void basic_particle_set<T>::resize(int n)
+{
+	this->x.resize(n);
+	this->y.resize(n);
+	this->t.resize(n);
+	this->w.resize(n);
+	this->lw.resize(n);
+}
+
+/** Reserve room for n particles, so later resizes up to n don't allocate
+ *	@param n the number of particles
+ */
+template <typename T>
+void basic_particle_set<T>::reserve(int n)
+{
+	this->x.reserve(n);
+	this->y.reserve(n);
+	this->t.reserve(n);
+	this->w.reserve(n);
+	this->lw.reserve(n);
+}
+
+/** Exchange the contents with another set without copying any particles
+ *	@param other the set to swap with
+ */
+template <typename T>
+void basic_particle_set<T>::swap(basic_particle_set &other)
+{
+	this->x.swap(other.x);
+	this->y.swap(other.y);
+	this->t.swap(other.t);
+	this->w.swap(other.w);
+	this->lw.swap(other.lw);
+}
+
+/** Get the number of particles in the set
+ *	@return the number of particles
+ */
+template <typename T>
+int basic_particle_set<T>::size(void) const
+{
+	return (int)this->x.size();
+}
+
+/** Reduce the weighted particles to a pose estimate in a single pass
+ *	The x, y moments are taken about a reference point, and theta about a
+ *	reference heading after wrapping to +-180, so the sums stay small and a
+ *	cloud that straddles the +-180 seam doesn't average out to 0. The
+ *	heading itself is the circular (vector) mean. The loop has no branches
+ *	and only plain sums, so the compiler is free to vectorize it. The sums
+ *	are always kept in double, even for a float set
+ *	@param pose (output) the weighted mean and covariance
+ *	@param refx the reference x, any nearby point (e.g. the last estimate)
+ *	@param refy the reference y
+ *	@param reft the reference heading (degrees)
+ */
+template <typename T>
+void basic_particle_set<T>::estimate(pose_estimate &pose, double refx, double refy, double reft) const
+{
+	int N = this->size();
+	const T *px = this->x.data();
+	const T *py = this->y.data();
+	const T *pt = this->t.data();
+	const T *pw = this->w.data();
+	double W = 0, sx = 0, sy = 0, st = 0;
+	double sxx = 0, sxy = 0, sxt = 0, syy = 0, syt = 0, stt = 0;
+	double sc = 0, ss = 0;
+	for (int i = 0; i < N; i++)
+	{
+		double w = pw[i];
+		double dx = px[i] - refx;
+		double dy = py[i] - refy;
+		double dt = pt[i] - reft;
+		dt -= 360.0 * floor((dt + 180.0) / 360.0);
+		double wx = w * dx;
+		double wy = w * dy;
+		double wt = w * dt;
+		W += w;
+		sx += wx;
+		sy += wy;
+		st += wt;
+		sxx += wx * dx;
+		sxy += wx * dy;
+		sxt += wx * dt;
+		syy += wy * dy;
+		syt += wy * dt;
+		stt += wt * dt;
+		sc += w * cos(dt * (M_PI / 180.0));
+		ss += w * sin(dt * (M_PI / 180.0));
+	}
+	if (!(W > 0))
+	{
+		pose.x = refx;
+		pose.y = refy;
+		pose.t = reft;
+		for (int i = 0; i < 9; i++)
+		{
+			pose.cov[i] = 0;
+		}
+		return;
+	}
+	double mx = sx / W;
+	double my = sy / W;
+	double mt = st / W;
+	pose.x = refx + mx;
+	pose.y = refy + my;
+	pose.t = reft + atan2(ss, sc) * (180.0 / M_PI);
+	pose.t -= 360.0 * floor((pose.t + 180.0) / 360.0);
+	// cov = E[d d^T] - E[d] E[d]^T, which doesn't depend on the reference
+	// as long as the heading spread stays within +-180 of it
+	pose.cov[0] = sxx / W - mx * mx;
+	pose.cov[1] = sxy / W - mx * my;
+	pose.cov[2] = sxt / W - mx * mt;
+	pose.cov[4] = syy / W - my * my;
+	pose.cov[5] = syt / W - my * mt;
+	pose.cov[8] = stt / W - mt * mt;
+	pose.cov[3] = pose.cov[1];
+	pose.cov[6] = pose.cov[2];
+	pose.cov[7] = pose.cov[5];
+}
+
+/** Advance a range of particles by one motion command, same model as
+ *	sim_robot::move(vx, vy, w) but over the whole array
+ *	Each particle takes one sin/cos pair (the compiler fuses them into a
+ *	single sincos, sincosf for float) and is clamped to the map in the same
+ *	pass with plain min/max, so the loop has no branches and no other calls
+ *	@param begin the first particle
+ *	@param end one past the last particle
+ *	@param vx the sideways velocity (to the right)
+ *	@param vy the forward velocity
+ *	@param w the angular velocity (degrees)
+ *	@param nt the heading noise of each particle, from begin
+ *	@param nv the speed noise of each particle, from begin
+ *	@param nl the slip noise (sideways to the motion) of each particle, from begin
+ *	@param xmax the largest x on the map
+ *	@param ymax the largest y on the map
+ */
+template <typename T>
+void basic_particle_set<T>::move(int begin, int end, T vx, T vy, T w, const T *nt, const T *nv, const T *nl, T xmax, T ymax)
+{
+	T *px = this->x.data() + begin;
+	T *py = this->y.data() + begin;
+	T *pt = this->t.data() + begin;
+	const T torad = (T)(M_PI / 180.0);
+	int n = end - begin;
+	for (int i = 0; i < n; i++)
+	{
+		pt[i] += w * (1 + nt[i]);
+		T a = pt[i] * torad;
+		T c = std::cos(a);
+		T s = std::sin(a);
+		// slip grows with distance, not with the sample rate
+		T side = vx * (1 + nv[i]) + vy * nl[i];
+		T forward = vy * (1 + nv[i]) - vx * nl[i];
+		T nx = px[i] + forward * c + side * s;
+		T ny = py[i] + forward * s - side * c;
+		// circular world!!!!
+		nx = (nx < 0) ? 0 : nx;
+		ny = (ny < 0) ? 0 : ny;
+		px[i] = (nx > xmax) ? xmax : nx;
+		py[i] = (ny > ymax) ? ymax : ny;
+	}
+}
+
+template class basic_particle_set<float>;
+template class basic_particle_set<double>;
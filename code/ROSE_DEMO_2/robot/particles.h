@@ -0,0 +1,43 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <vector>
+
+#include "pose.h"
+
+/** Structure-of-arrays storage for the particle filter
+ *	Each particle is split across the x, y, t (theta, in degrees), w
+ *	(normalized weight) and lw (log weight) arrays, so the per-particle loops
+ *	stream through contiguous memory instead of hopping over whole sim_robot
+ *	objects
+ *	T is the storage precision: float halves the memory traffic of the
+ *	particle loops and doubles their SIMD width, double is kept to check
+ *	the float build against
+ */
+template <typename T>
+class basic_particle_set
+{
+	public:
+		basic_particle_set(void);
+		~basic_particle_set(void);
+		void resize(int n);
+		void reserve(int n);
+		void swap(basic_particle_set &other);
+		int size(void) const;
+		void estimate(pose_estimate &pose, double refx, double refy, double reft) const;
+		void move(int begin, int end, T vx, T vy, T w, const T *nt, const T *nv, const T *nl, T xmax, T ymax);
+
+		std::vector<T> x;
+		std::vector<T> y;
+		std::vector<T> t;
+		std::vector<T> w;
+		std::vector<T> lw;
+};
+
+typedef basic_particle_set<double> particle_set;
+typedef basic_particle_set<float> particle_set_f;
+
+#endif
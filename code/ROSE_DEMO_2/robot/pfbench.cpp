@@ -0,0 +1,434 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+// Replays a recorded log through the particle filter as fast as it can go,
+// for every combination of particle count, thread count and precision, and
+// reports the latency of each stage, the update rate and the pose error
+//
+//	usage: pfbench <log> [-n 250,500,1000] [-t 1,2,4] [-p double,float] [-s seed]
+//	               [-m pf,ekf]
+//	       pfbench --synth <out log> <map image> [frames] [seed]
+//
+// -m ekf also replays through the localizer interface the way runrobot
+// does, handing over to the EKF once the particles converge and back when
+// the tags stop agreeing with it, and reports how long the EKF held on
+// --synth drives a simulated robot up and down the hallway, and writes its
+// encoders, the tags it could see and where it really was, so there is
+// something to replay without the robot
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ekf.h"
+#include "pfilter.h"
+#include "pflog.h"
+#include "visibility.h"
+
+using namespace std;
+
+typedef chrono::steady_clock bench_clock;
+
+static double wrap180(double x)
+{
+	return x - 360.0 * floor((x + 180.0) / 360.0);
+}
+
+static vector<int> parse_list(const char *arg)
+{
+	vector<int> values;
+	stringstream ss(arg);
+	string item;
+	while (getline(ss, item, ','))
+	{
+		values.push_back(atoi(item.c_str()));
+	}
+	return values;
+}
+
+/** Latency samples of one stage, in microseconds
+ */
+struct stage_times
+{
+	vector<double> us;
+
+	double percentile(double p)
+	{
+		if (us.empty())
+		{
+			return 0;
+		}
+		int k = (int)ceil(p / 100.0 * us.size()) - 1;
+		k = (k < 0) ? 0 : k;
+		nth_element(us.begin(), us.begin() + k, us.end());
+		return us[k];
+	}
+};
+
+/** What one replay measured
+ */
+struct bench_result
+{
+	stage_times move;
+	stage_times observe;
+	stage_times estimate;
+	double seconds;
+	int nerror;
+	double sumsq_pos;
+	double sumsq_t;
+	int ekf_frames; // frames the EKF was tracking, with -m ekf
+	int handovers;
+	int handbacks;
+};
+
+static double elapsed_us(bench_clock::time_point a, bench_clock::time_point b)
+{
+	return chrono::duration<double, micro>(b - a).count();
+}
+
+/** Replay the whole log through one filter setup
+ */
+template <typename P>
+static void replay(const pflog &log, sim_map &map, const landmark_visibility &visibility,
+	int nparticles, int nthreads, uint64_t seed, bench_result &result)
+{
+	P pf(nparticles, &map, log.landmarks, log.x, log.y, log.t, 100, seed, nthreads);
+	pf.set_noise(0.1, 0.2);
+	pf.set_recovery(0.001, 0.1);
+	pf.set_visibility(&visibility);
+
+	int nframes = (int)log.frames.size();
+	result.move.us.reserve(nframes);
+	result.observe.us.reserve(nframes);
+	result.estimate.us.reserve(nframes);
+	result.nerror = 0;
+	result.sumsq_pos = 0;
+	result.sumsq_t = 0;
+	pose_estimate pose;
+	bench_clock::time_point start = bench_clock::now();
+	for (const pflog_frame &frame : log.frames)
+	{
+		bench_clock::time_point t0 = bench_clock::now();
+		pf.move(frame.odom);
+		bench_clock::time_point t1 = bench_clock::now();
+		pf.observe(frame.tags);
+		bench_clock::time_point t2 = bench_clock::now();
+		pf.estimate(pose);
+		bench_clock::time_point t3 = bench_clock::now();
+		result.move.us.push_back(elapsed_us(t0, t1));
+		result.observe.us.push_back(elapsed_us(t1, t2));
+		result.estimate.us.push_back(elapsed_us(t2, t3));
+		if (frame.has_truth)
+		{
+			double dx = pose.x - frame.x;
+			double dy = pose.y - frame.y;
+			double dt = wrap180(pose.t - frame.t);
+			result.nerror++;
+			result.sumsq_pos += dx * dx + dy * dy;
+			result.sumsq_t += dt * dt;
+		}
+	}
+	result.seconds = chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+/** Replay the whole log through the double filter with the EKF handover
+ *	that localize_pose does, using the same thresholds
+ */
+static void replay_handover(const pflog &log, sim_map &map, const landmark_visibility &visibility,
+	int nparticles, int nthreads, uint64_t seed, bench_result &result)
+{
+	pfilter pf(nparticles, &map, log.landmarks, log.x, log.y, log.t, 100, seed, nthreads);
+	pf.set_noise(0.1, 0.2);
+	pf.set_recovery(0.001, 0.1);
+	pf.set_visibility(&visibility);
+	ekf tracker(log.landmarks);
+	tracker.set_noise(0.1, 0.2);
+	localizer *active = &pf;
+	const double handover_sigma = 5;
+	const double handover_sigma_t = 5;
+	const int handover_updates = 10;
+	const int max_failures = 3;
+	int tight = 0;
+
+	int nframes = (int)log.frames.size();
+	result.move.us.reserve(nframes);
+	result.observe.us.reserve(nframes);
+	result.estimate.us.reserve(nframes);
+	result.nerror = 0;
+	result.sumsq_pos = 0;
+	result.sumsq_t = 0;
+	result.ekf_frames = 0;
+	result.handovers = 0;
+	result.handbacks = 0;
+	pose_estimate pose;
+	bench_clock::time_point start = bench_clock::now();
+	for (const pflog_frame &frame : log.frames)
+	{
+		bench_clock::time_point t0 = bench_clock::now();
+		active->move(frame.odom);
+		bench_clock::time_point t1 = bench_clock::now();
+		active->observe(frame.tags);
+		bench_clock::time_point t2 = bench_clock::now();
+		active->estimate(pose);
+		bench_clock::time_point t3 = bench_clock::now();
+		result.move.us.push_back(elapsed_us(t0, t1));
+		result.observe.us.push_back(elapsed_us(t1, t2));
+		result.estimate.us.push_back(elapsed_us(t2, t3));
+		if (active == &tracker)
+		{
+			result.ekf_frames++;
+		}
+		if (frame.has_truth)
+		{
+			double dx = pose.x - frame.x;
+			double dy = pose.y - frame.y;
+			double dt = wrap180(pose.t - frame.t);
+			result.nerror++;
+			result.sumsq_pos += dx * dx + dy * dy;
+			result.sumsq_t += dt * dt;
+		}
+
+		if (active == &pf)
+		{
+			bool converged = pose.cov[0] < handover_sigma * handover_sigma &&
+				pose.cov[4] < handover_sigma * handover_sigma &&
+				pose.cov[8] < handover_sigma_t * handover_sigma_t;
+			tight = converged ? tight + 1 : 0;
+			if (tight >= handover_updates)
+			{
+				tracker.reset(pose);
+				active = &tracker;
+				result.handovers++;
+			}
+		}
+		else if (tracker.failures() >= max_failures)
+		{
+			pf.reset(pose);
+			active = &pf;
+			tight = 0;
+			result.handbacks++;
+		}
+	}
+	result.seconds = chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+static void print_row(const char *precision, int nparticles, int nthreads, int nframes, bench_result &result)
+{
+	printf("%-7s %6d %4d %10.0f  %7.1f %7.1f  %7.1f %7.1f  %7.1f %7.1f",
+		precision, nparticles, nthreads, nframes / result.seconds,
+		result.move.percentile(50), result.move.percentile(99),
+		result.observe.percentile(50), result.observe.percentile(99),
+		result.estimate.percentile(50), result.estimate.percentile(99));
+	if (result.nerror > 0)
+	{
+		printf("  %8.3f %8.3f\n", sqrt(result.sumsq_pos / result.nerror), sqrt(result.sumsq_t / result.nerror));
+	}
+	else
+	{
+		printf("  %8s %8s\n", "-", "-");
+	}
+}
+
+/** Simulate a run down the hallway and back and write it as a log
+ *	The encoder ticks are the inverse of the default mecanum_odometry
+ */
+static int synthesize(const char *path, const char *map_name, int nframes, uint64_t seed)
+{
+	mecanum_odometry model;
+	const double speed = 2.0; // map cells per frame
+	const double turn = 10.0; // degrees per frame
+	const double dt = 0.05; // seconds per frame
+	const double max_range = 250;
+	const double fov = 60; // half angle, degrees
+
+	sim_map map;
+	map.load(map_name);
+	if (map.free_cells.empty())
+	{
+		printf("could not load %s\n", map_name);
+		return 1;
+	}
+	pflog log;
+	log.map_name = map_name;
+	log.landmarks = landmark_table(hallway_landmarks());
+	log.x = 75;
+	log.y = 60;
+	log.t = 90;
+	workpool pool(1);
+	landmark_visibility visibility;
+	visibility.build(map, log.landmarks, pool);
+	rng random(seed);
+
+	double x = log.x, y = log.y, t = log.t;
+	double enc[4] = { 0, 0, 0, 0 };
+	int turning = 0;
+	for (int k = 0; k < nframes; k++)
+	{
+		if (turning == 0)
+		{ // go straight until a wall is close ahead
+			double c = cos(t * M_PI / 180.0);
+			double s = sin(t * M_PI / 180.0);
+			if (!map.is_free(x + 20 * c, y + 20 * s))
+			{
+				turning = (int)(180 / turn);
+			}
+		}
+		double ticks[4];
+		if (turning > 0)
+		{ // turn in place: d = (-a, a, -a, a) gives w = a * k_rotation
+			double a = turn / model.k_rotation;
+			ticks[0] = -a; ticks[1] = a; ticks[2] = -a; ticks[3] = a;
+			t = wrap180(t + turn);
+			turning--;
+		}
+		else
+		{ // drive straight: equal ticks give vy = d * k_forward and nothing else
+			double d = speed / model.k_forward;
+			ticks[0] = ticks[1] = ticks[2] = ticks[3] = d;
+			x += speed * cos(t * M_PI / 180.0);
+			y += speed * sin(t * M_PI / 180.0);
+		}
+
+		pflog_frame frame;
+		frame.odom.timestamp = k * dt;
+		for (int i = 0; i < 4; i++)
+		{
+			enc[i] += ticks[i] * (1 + random.gaussian(0.02));
+			frame.odom.enc[i] = enc[i];
+		}
+		for (int id = 0; id < log.landmarks.size(); id++)
+		{
+			if (!log.landmarks.contains(id))
+			{
+				continue;
+			}
+			double dx = log.landmarks.x[id] - x;
+			double dy = log.landmarks.y[id] - y;
+			double range = sqrt(dx * dx + dy * dy);
+			double bearing = wrap180(atan2(dy, dx) * 180.0 / M_PI - t);
+			if (range > max_range || fabs(bearing) > fov || !visibility.visible((int)round(x), (int)round(y), id))
+			{
+				continue;
+			}
+			tag_observation obs = { id, range + random.gaussian(2.0), bearing + random.gaussian(2.0), frame.odom.timestamp };
+			frame.tags.push_back(obs);
+		}
+		frame.has_truth = true;
+		frame.x = x;
+		frame.y = y;
+		frame.t = t;
+		log.frames.push_back(frame);
+	}
+	if (!log.save(path))
+	{
+		printf("could not write %s\n", path);
+		return 1;
+	}
+	printf("wrote %d frames to %s\n", nframes, path);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc >= 4 && strcmp(argv[1], "--synth") == 0)
+	{
+		int nframes = (argc > 4) ? atoi(argv[4]) : 2000;
+		uint64_t seed = (argc > 5) ? strtoull(argv[5], NULL, 10) : 0;
+		return synthesize(argv[2], argv[3], nframes, seed);
+	}
+	if (argc < 2)
+	{
+		printf("usage: %s <log> [-n 250,500,1000] [-t 1,2,4] [-p double,float] [-s seed]\n", argv[0]);
+		printf("       %*s [-m pf,ekf]\n", (int)strlen(argv[0]), "");
+		printf("       %s --synth <out log> <map image> [frames] [seed]\n", argv[0]);
+		return 1;
+	}
+
+	vector<int> counts = { 250, 500, 1000, 2000 };
+	vector<int> threads = { 1, 2, 4 };
+	bool use_double = true;
+	bool use_float = true;
+	uint64_t seed = 0;
+	bool use_pf = true;
+	bool use_ekf = false;
+	for (int i = 2; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "-n") == 0)
+		{
+			counts = parse_list(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-t") == 0)
+		{
+			threads = parse_list(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-p") == 0)
+		{
+			use_double = strstr(argv[i + 1], "double") != NULL;
+			use_float = strstr(argv[i + 1], "float") != NULL;
+		}
+		else if (strcmp(argv[i], "-s") == 0)
+		{
+			seed = strtoull(argv[i + 1], NULL, 10);
+		}
+		else if (strcmp(argv[i], "-m") == 0)
+		{
+			use_pf = strstr(argv[i + 1], "pf") != NULL;
+			use_ekf = strstr(argv[i + 1], "ekf") != NULL;
+		}
+	}
+
+	pflog log;
+	if (!log.load(argv[1]))
+	{
+		printf("could not read %s\n", argv[1]);
+		return 1;
+	}
+	sim_map map;
+	map.load(log.map_name);
+	if (map.free_cells.empty())
+	{
+		printf("could not load %s\n", log.map_name.c_str());
+		return 1;
+	}
+	workpool pool((int)thread::hardware_concurrency());
+	landmark_visibility visibility;
+	visibility.build(map, log.landmarks, pool);
+	int nframes = (int)log.frames.size();
+
+	printf("%d frames from %s, times in microseconds\n", nframes, argv[1]);
+	printf("%-7s %6s %4s %10s  %7s %7s  %7s %7s  %7s %7s  %8s %8s\n",
+		"prec", "N", "thr", "updates/s", "move50", "move99", "obs50", "obs99", "est50", "est99", "rms pos", "rms deg");
+	for (int nparticles : counts)
+	{
+		for (int nthreads : threads)
+		{
+			if (use_pf && use_double)
+			{
+				bench_result result;
+				replay<pfilter>(log, map, visibility, nparticles, nthreads, seed, result);
+				print_row("double", nparticles, nthreads, nframes, result);
+			}
+			if (use_pf && use_float)
+			{
+				bench_result result;
+				replay<pfilter_f>(log, map, visibility, nparticles, nthreads, seed, result);
+				print_row("float", nparticles, nthreads, nframes, result);
+			}
+			if (use_ekf)
+			{
+				bench_result result;
+				replay_handover(log, map, visibility, nparticles, nthreads, seed, result);
+				print_row("ekf", nparticles, nthreads, nframes, result);
+				printf("        on the EKF for %d of %d frames, %d handovers, %d handbacks\n",
+					result.ekf_frames, nframes, result.handovers, result.handbacks);
+			}
+		}
+	}
+	return 0;
+}
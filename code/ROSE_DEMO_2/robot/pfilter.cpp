@@ -1,82 +1,150 @@
 // Written by:	Ajay Srivastava, Srihari Chekuri
 // Tested by: 	Ajay Srivastava, Srihari Chekuri
 
+#include <algorithm>
 #include <cmath>
 #include <ctime>
 #include <random>
 
 #include "mathfun.h"
 #include "pfilter.h"
-#include "sim_robot.h"
 
 using namespace arma;
 using namespace std;
 
-struct timeval currenttime;
-struct timeval prevtime;
-vec prevenc(4, fill::zeros);
-
-static double erfinv(double p);
-static double gaussianNoise(double sigma);
-static double gauss(double mu, double sigma2);
-static double secdiff(struct timeval &t1, struct timeval &t2);
+template <typename T>
+static inline T wrap180(T x);
 
 /** This is the default constructor
  */
-pfilter::pfilter(void)
+template <typename T>
+basic_pfilter<T>::basic_pfilter(void) :
+	pool(make_shared<workpool>(1)), streams(1), adaptive(false), resample_threshold(0.5),
+	recovery(false), alpha_slow(0), alpha_fast(0), inject_threshold(0.3), w_slow(0), w_fast(0),
+	range_coef(0.5 / 10.0), bearing_coef(0.5 / 5.0), table(make_shared<const landmark_table>()),
+	visibility(NULL), occluded_loglik(-10), last_sighting(0)
 {
-	// initial start time for odometry (See move function)
-	gettimeofday(&prevtime, NULL);
+	last = pose_estimate();
 }
 
 /** This is the constructor for the particle filter (think of it as your init)
  *	@param nparticles the number of particles to create
  *	@param map the pointer to the map (just store it)
- *	@param landmarks a list of landmarks, where each landmark is described in sim_landmark.h
+ *	@param landmarks the landmarks by tag id, a list of sim_landmark converts
+ *		to this with every id valid. The filter keeps its own copy
+ *	@param seed the seed for this filter's random number engine
+ *	@param nthreads the number of workers for move and weigh, results are
+ *		reproducible for a given seed and worker count
+ */
+template <typename T>
+basic_pfilter<T>::basic_pfilter(int nparticles, const sim_map *map, const landmark_table &landmarks, double x, double y, double t, double initial_sigma, uint64_t seed, int nthreads) :
+	basic_pfilter(nparticles, map, make_shared<const landmark_table>(landmarks), x, y, t, initial_sigma, seed, nthreads)
+{
+}
+
+/** The same, on a landmark table shared with other filters, so a fleet of
+ *	them on one building holds one copy of it
+ *	@param landmarks the landmarks by tag id, nobody may change it while a
+ *		filter holds it
  */
-pfilter::pfilter(int nparticles, sim_map *map, vector<sim_landmark> &landmarks, double x, double y, double t, double initial_sigma)
+template <typename T>
+basic_pfilter<T>::basic_pfilter(int nparticles, const sim_map *map, shared_ptr<const landmark_table> landmarks, double x, double y, double t, double initial_sigma, uint64_t seed, int nthreads) :
+	random(seed), pool(make_shared<workpool>(nthreads)), adaptive(false), resample_threshold(0.5),
+	recovery(false), alpha_slow(0), alpha_fast(0), inject_threshold(0.3), w_slow(0), w_fast(0),
+	range_coef(0.5 / 10.0), bearing_coef(0.5 / 5.0), table(landmarks), visibility(NULL),
+	occluded_loglik(-10), last_sighting(0)
 {
-	double x_, y_, t_;
 	// STEP 1: store the map and landmark variables
 	this->map = map;
-	this->landmarks = landmarks;
 
 	// STEP 2: create a bunch of particles, place them into this->particles
-	vector<sim_robot> new_particles;
-	for (int i = 0; i < nparticles; i++)
+	particles.resize(nparticles);
+	scatter(x, y, t, initial_sigma, initial_sigma, 5.0); // +- 5 degrees
+
+	// the seed pose is the first reference for the estimates
+	last = pose_estimate();
+	last.x = x;
+	last.y = y;
+	last.t = t;
+	buffer.resize(nparticles);
+
+	// give each worker its own non-overlapping noise stream
+	rng stream = random;
+	for (int i = 0; i < pool->size(); i++)
 	{
-		x_ = x + gaussianNoise(initial_sigma);
-		y_ = y + gaussianNoise(initial_sigma);
-		t_ = t + gaussianNoise(5.0); // +- 5 degrees
-		sim_robot newbot;
-		newbot.set_pose(x_, y_, t_);
-		new_particles.push_back(newbot);
+		stream.jump();
+		streams.push_back(stream);
 	}
-	particles.clear();
-	particles = new_particles;
+}
 
-	// STEP 3: initialize the health as a vec of ones
-	health = ones<vec>(nparticles);
+template <typename T>
+basic_pfilter<T>::~basic_pfilter(void)
+{
+}
 
-	// set the start time for odometry
-	gettimeofday(&prevtime, NULL);
+/** Scatter the particles around a pose and make the health uniform
+ *	@param x the x of the pose
+ *	@param y the y of the pose
+ *	@param t the theta of the pose
+ *	@param sx the x spread
+ *	@param sy the y spread
+ *	@param st the theta spread (degrees)
+ */
+template <typename T>
+void basic_pfilter<T>::scatter(double x, double y, double t, double sx, double sy, double st)
+{
+	int n = particles.size();
+	random.gaussian(particles.x.data(), n, sx * RNG_NOISE_SCALE);
+	random.gaussian(particles.y.data(), n, sy * RNG_NOISE_SCALE);
+	random.gaussian(particles.t.data(), n, st * RNG_NOISE_SCALE);
+	for (int i = 0; i < n; i++)
+	{
+		double px = particles.x[i] + x;
+		double py = particles.y[i] + y;
+		// redraw the ones that landed in a wall a few times, and if the seed
+		// pose is that far off, fall back to any open cell
+		for (int tries = 0; tries < 8 && !map->is_free(px, py); tries++)
+		{
+			px = x + random.gaussian(sx * RNG_NOISE_SCALE);
+			py = y + random.gaussian(sy * RNG_NOISE_SCALE);
+		}
+		if (!map->is_free(px, py))
+		{
+			map->sample_free(random, px, py);
+		}
+		particles.x[i] = (T)px;
+		particles.y[i] = (T)py;
+		particles.t[i] += (T)t;
+	}
+	std::fill(particles.w.begin(), particles.w.end(), (T)(1.0 / n));
+	std::fill(particles.lw.begin(), particles.lw.end(), (T)-log((double)n));
 }
 
-pfilter::~pfilter(void)
+/** Start the particles over around a pose, for taking back over from
+ *	another localizer. The spread is twice the pose's own sigma, since it is
+ *	handed over when that localizer stopped trusting itself, and never
+ *	tighter than 10 units or 5 degrees. This also restarts the encoder
+ *	reference
+ *	@param pose the pose and its covariance
+ */
+template <typename T>
+void basic_pfilter<T>::reset(const pose_estimate &pose)
 {
+	double sx = std::max(2 * sqrt(std::max(pose.cov[0], 0.0)), 10.0);
+	double sy = std::max(2 * sqrt(std::max(pose.cov[4], 0.0)), 10.0);
+	double st = std::max(2 * sqrt(std::max(pose.cov[8], 0.0)), 5.0);
+	scatter(pose.x, pose.y, pose.t, sx, sy, st);
+	last = pose;
+	odometry.reset();
 }
 
 /** Set the noise for each robot
  *	@param vs the velocity sigma2
  *	@param ws the angular velocity sigma2
  */
-void pfilter::set_noise(double vs, double ws)
+template <typename T>
+void basic_pfilter<T>::set_noise(double vs, double ws)
 {
-	// Set the noise for each robot
-	for (sim_robot &bot : this->particles)
-	{
-		bot.set_noise(vs, ws);
-	}
 	this->vs = vs;
 	this->ws = ws;
 }
@@ -84,213 +152,504 @@ void pfilter::set_noise(double vs, double ws)
 /** Set the size for each robot
  *	@param r the radius of the robot
  */
-void pfilter::set_size(double r)
+template <typename T>
+void basic_pfilter<T>::set_size(double r)
 {
-	for (sim_robot &bot : this->particles)
-	{
-		bot.set_size(r);
-	}
+	this->r = r;
+}
+
+/** Let the particle count adapt with KLD-sampling: each resample picks
+ *	the count from how spread out the weighted particles are
+ *	@param nmin the least number of particles
+ *	@param nmax the most number of particles
+ *	@param binsize the x/y bin width of the KLD histogram
+ *	@param binangle the theta bin width of the KLD histogram (degrees)
+ */
+template <typename T>
+void basic_pfilter<T>::set_adaptive(int nmin, int nmax, double binsize, double binangle)
+{
+	this->adaptive = true;
+	this->kld = kld_sampler(nmin, nmax, binsize, binangle);
+	// grab the memory up front so that resizing doesn't allocate later
+	particles.reserve(nmax);
+	buffer.reserve(nmax);
+	noise.reserve(3 * nmax);
 }
 
-/** Move each robot by some velocity and angular velocity
+/** Move each robot by the strafe, forward and angular velocity that the
+ *	mecanum odometry gets out of the encoders
  *	In here, also detect if the robot's position goes out of range,
  *	and handle it
  *	Pretend that the world is circular
- *	@param sensors the sensors used to detect robot motion
+ *	Every new sample is integrated against the one before it, so this can
+ *	be called at the encoder rate. The first sample only sets the reference
+ *	@param sample the timestamped encoder reading
  */
-void pfilter::move(vec sensors)
+template <typename T>
+void basic_pfilter<T>::move(const odometry_sample &sample)
 {
-	gettimeofday(&currenttime, NULL);
-	if (secdiff(prevtime, currenttime) < 0.050)
-	{ // 20hz
+	odometry_twist twist;
+	if (!odometry.update(sample, twist))
+	{ // first, stale or repeated sample
 		return;
 	}
-	else
-	{
-		memcpy(&prevtime, &currenttime, sizeof(struct timeval));
+	if (twist.vx == 0 && twist.vy == 0 && twist.w == 0)
+	{ // the wheels didn't turn, so there's nothing to integrate
+		return;
 	}
-	vec enc = sensors(span(0,3));
-	double v, w;
-	double t2iK_forward = 0.246826621412;
-	vec dist = enc - prevenc;
-	v = mean(dist) * t2iK_forward;
-	dist -= (mean(dist) / t2iK_forward) * ones<vec>(4);
-	double t2iK_rotation = 2.2857123550422 / 2;
-	dist(0) *= -1;
-	dist(2) *= -1;
-	w = mean(dist) * t2iK_rotation;
-	prevenc = enc;
-
-	for (sim_robot &bot : this->particles)
+
+	noise.resize(3 * particles.size());
+	pool->run(particles.size(), [&](int worker, int begin, int end)
 	{
-		bot.move(0, v, w);
-		// circular world!!!!
-		bot.x = limit_value(bot.x, 0, (double)this->map->n_cols - 1);
-		bot.y = limit_value(bot.y, 0, (double)this->map->n_rows - 1);
-	}
+		this->move_range(worker, begin, end, (T)twist.vx, (T)twist.vy, (T)twist.w);
+	});
+}
+
+/** Use calibrated wheel constants for the odometry, this also restarts the
+ *	encoder reference
+ *	@param odometry the odometry model, see mecanum_odometry::load
+ */
+template <typename T>
+void basic_pfilter<T>::set_odometry(const mecanum_odometry &odometry)
+{
+	this->odometry = odometry;
+	this->odometry.reset();
+}
+
+/** Move a chunk of the particles, this runs on one worker
+ *	@param worker the worker id, which selects the noise stream
+ *	@param begin the first particle
+ *	@param end one past the last particle
+ *	@param vx the sideways velocity
+ *	@param vy the forward velocity
+ *	@param w the angular velocity
+ */
+template <typename T>
+void basic_pfilter<T>::move_range(int worker, int begin, int end, T vx, T vy, T w)
+{
+	// draw the noise for the whole chunk up front: heading, speed, slip
+	int n = end - begin;
+	T *nt = noise.data() + 3 * begin;
+	T *nv = nt + n;
+	T *nl = nv + n;
+	rng &stream = streams[worker];
+	stream.gaussian(nt, n, this->ws * RNG_NOISE_SCALE);
+	stream.gaussian(nv, n, this->vs * RNG_NOISE_SCALE);
+	stream.gaussian(nl, n, this->vs * RNG_NOISE_SCALE);
+
+	// same motion model as sim_robot::move(vx, vy, w), the particles carry
+	// no map so there is no collision test
+	particles.move(begin, end, vx, vy, w, nt, nv, nl, (T)this->map->n_cols - 1, (T)this->map->n_rows - 1);
+}
+
+/** Set the measurement noise of the landmark observations. The log
+ *	likelihood of a gaussian error e is -e^2 / (2 sigma2) plus a constant
+ *	that every particle shares, so only the quadratic coefficients are kept
+ *	@param range_sigma2 the variance of the range error
+ *	@param bearing_sigma2 the variance of the bearing error (degrees^2)
+ */
+template <typename T>
+void basic_pfilter<T>::set_measurement_noise(double range_sigma2, double bearing_sigma2)
+{
+	this->range_coef = 0.5 / range_sigma2;
+	this->bearing_coef = 0.5 / bearing_sigma2;
 }
 
 /** Weigh the "health" of each particle using gaussian error
- *	@param observations a 3xn matrix, where the first row is the x row,
- *											the second row is the y row,
- *											and the third row is the presence
- *	@param health the health vector
+ *	The error terms are summed into the log weights, which can't underflow
+ *	no matter how many landmarks are seen
+ *	@param observations the tags that were seen this update, sightings
+ *		stamped no later than ones already weighed are left out
  */
-void pfilter::weigh(mat &observations)
+template <typename T>
+void basic_pfilter<T>::weigh(const vector<tag_observation> &observations)
 {
-	vec theta(observations.n_cols);
-	vec radius(observations.n_cols);
-	vec R = observations.row(0).t();
-	vec T = observations.row(1).t();
-	for (int i = 0; i < (int)T.n_cols; i++)
+	// look up the sighted tags once, and skip any that aren't on the map.
+	// The weights carry over between updates, so a sighting that was
+	// already weighed would count twice, skip those too
+	sighted.clear();
+	sighted_bits.clear();
+	double newest = last_sighting;
+	for (const tag_observation &obs : observations)
 	{
-		T[i] = wrap_value(T[i], -180, 180);
+		if (!table->contains(obs.id) || (obs.timestamp > 0 && obs.timestamp <= last_sighting))
+		{
+			continue;
+		}
+		newest = (obs.timestamp > newest) ? obs.timestamp : newest;
+		sighted.push_back((T)table->x[obs.id]);
+		sighted.push_back((T)table->y[obs.id]);
+		sighted.push_back((T)obs.range);
+		sighted.push_back((T)wrap180(obs.bearing));
+		sighted_bits.push_back(visibility ? visibility->bit(obs.id) : -1);
 	}
-	for (int i = 0; i < particles.size(); i++)
+	last_sighting = newest;
+	pool->run(particles.size(), [&](int /*worker*/, int begin, int end)
 	{
-		sim_robot &particle = particles[i];
-		int x = (int)round(particle.x);
-		int y = (int)round(particle.y);
+		this->weigh_range(begin, end);
+	});
+}
+
+/** Weigh a chunk of the particles, this runs on one worker
+ *	@param begin the first particle
+ *	@param end one past the last particle
+ */
+template <typename T>
+void basic_pfilter<T>::weigh_range(int begin, int end)
+{
+	const T *px = particles.x.data();
+	const T *py = particles.y.data();
+	const T *pt = particles.t.data();
+	T *plw = particles.lw.data();
+	const T *obs = sighted.data();
+	const int *bits = sighted_bits.data();
+	const T rc = (T)range_coef;
+	const T bc = (T)bearing_coef;
+	const T todeg = (T)(180.0 / M_PI);
+	int nobs = (int)sighted.size() / 4;
+	for (int i = begin; i < end; i++)
+	{
+		int x = (int)round(px[i]);
+		int y = (int)round(py[i]);
 		if (x < 0 || x >= (int)map->n_cols || y < 0 || y >= (int)map->n_rows || map->map(y, x) > 0.5)
 		{
-			this->health[i] = 0;
+			plw[i] = -HUGE_VAL;
 			continue;
 		}
-		for(int j = 0; j < landmarks.size(); j++)
-		{ // change this to use observations later
-			if (observations(2, j) > 0.5)
-			{
-				sim_landmark &landmark = landmarks[j];
-				vec diff({ landmark.x - particle.x, landmark.y - particle.y });
-				radius[j] = eucdist(diff); // radius of the robot
-				theta[j] = wrap_value(angle(diff) - particle.t, -180, 180); // theta of the robot
-				this->health[i] *= gauss(abs(R[j] - radius[j]), 10.0);
-				this->health[i] *= gauss(wrap_value(T[j] - theta[j], -180, 180), 5.0);
+		T loglik = 0;
+		const uint64_t *seen = visibility ? visibility->pattern(x, y) : NULL;
+		for (int j = 0; j < nobs; j++)
+		{
+			int k = bits[j];
+			if (seen && k >= 0 && !((seen[k >> 6] >> (k & 63)) & 1))
+			{ // there's a wall in the way, so the tag is only a poor fit
+				loglik += (T)occluded_loglik;
+				if (!(loglik > -HUGE_VAL))
+				{
+					break; // impossible, no need to score the rest
+				}
+				continue;
 			}
+			const T *o = obs + 4 * j;
+			T dx = o[0] - px[i];
+			T dy = o[1] - py[i];
+			T radius = sqrt(dx * dx + dy * dy); // radius of the robot
+			T theta = atan2(dy, dx) * todeg - pt[i]; // theta of the robot
+			T er = o[2] - radius;
+			T et = wrap180(o[3] - theta);
+			loglik -= rc * er * er + bc * et * et;
 		}
+		plw[i] += loglik;
 	}
 }
 
-/** Resample all the particles based on the health using the resample wheel
- *	@param health the health of all the particles
+/** Resample all the particles based on the health using low variance
+ *	(systematic) resampling. A single uniform draw places N evenly spaced
+ *	pointers over the cumulative health, so the pass is O(N). The new set is
+ *	written into the preallocated back buffer, which is then swapped in.
+ *	If the filter is adaptive, the new set's size comes from KLD-sampling
+ *	@param inject the chance of replacing each new particle with a random
+ *		pose in open space
  */
-void pfilter::resample(void)
+template <typename T>
+void basic_pfilter<T>::resample(double inject)
 {
 	int N = particles.size();
-	vector<sim_robot> p2;
-	int index = (int)rand() % N;
-	double beta = 0;
-	double mw = max(health);
-	if (mw == 0)
+	const T *pw = particles.w.data();
+	double total = 0;
+	for (int i = 0; i < N; i++)
+	{
+		total += pw[i];
+	}
+	if (N == 0 || total <= 0)
 	{
 		return; // nothing to resample
 	}
-	for (int i = 0; i < N; i++)
+	int M = adaptive ? kld.count(particles) : N;
+	M = (M < 1) ? 1 : M; // the bound is 0 when nmin is and every particle shares a bin
+	buffer.resize(M); // no-op unless the particle count changed
+	double step = total / M;
+	double u = random.uniform() * step;
+	double cumulative = pw[0];
+	T neww = (T)(1.0 / M);
+	T logw = (T)-log((double)M);
+	int index = 0;
+	for (int i = 0; i < M; i++)
 	{
-		beta += ((double)rand() / (double)RAND_MAX) * 2 * mw;
-		while (beta >= health[index])
+		double pointer = u + i * step;
+		while (pointer >= cumulative && index < N - 1)
 		{
-			beta -= health[index];
-			index = (index + 1) % N;
+			index++;
+			cumulative += pw[index];
 		}
-		p2.push_back(particles[index]);
+		buffer.x[i] = particles.x[index];
+		buffer.y[i] = particles.y[index];
+		buffer.t[i] = particles.t[index];
+		buffer.w[i] = neww;
+		buffer.lw[i] = logw;
 	}
-	particles.clear();
-	particles = p2;
+	if (inject > 0 && !map->free_cells.empty())
+	{
+		for (int i = 0; i < M; i++)
+		{
+			if (random.uniform() >= inject)
+			{
+				continue;
+			}
+			double px, py;
+			map->sample_free(random, px, py);
+			buffer.x[i] = (T)px;
+			buffer.y[i] = (T)py;
+			buffer.t[i] = (T)(random.uniform() * 360.0 - 180.0);
+		}
+	}
+	particles.swap(buffer);
 }
 
 /** Call the weigh and resample functions from here
- *	@param observations the observations of the landmarks
+ *	@param observations a 3xn matrix, where column j is tag j's range,
+ *		bearing, and presence
  */
-void pfilter::observe(mat observations)
+template <typename T>
+void basic_pfilter<T>::observe(mat observations)
 {
-	if (observations.n_cols > 0)
-	{
 	// each column of obs matches to each col of landmarks
-		health = ones<vec>(particles.size());
-		weigh(observations);
-    resample();
+	dense.clear();
+	for (int j = 0; j < (int)observations.n_cols; j++)
+	{
+		if (observations(2, j) > 0.5)
+		{
+			tag_observation obs = { j, observations(0, j), observations(1, j), 0 };
+			dense.push_back(obs);
+		}
 	}
+	observe(dense);
 }
 
-/** Predict the position and calculate the error of the particle set
- *	@param mu (output) the position ( x, y, theta )
- *	@param sigma (output) the error
+/** Call the weigh and resample functions from here
+ *	An empty list still rules out particles that sit inside walls, and so
+ *	does a list that was already observed, see weigh
+ *	@param observations the tags that were seen, in any order
  */
-void pfilter::predict(vec &mu, mat &sigma)
+template <typename T>
+void basic_pfilter<T>::observe(const vector<tag_observation> &observations)
 {
-	mu = zeros<vec>(3);
-	for (int i = 0; i < particles.size(); i++)
+	// the weights carry over from the last observation
+	weigh(observations);
+	double lognorm;
+	if (!normalize(lognorm))
+	{ // every particle is impossible, start the weights over
+		std::fill(particles.w.begin(), particles.w.end(), (T)(1.0 / particles.size()));
+		std::fill(particles.lw.begin(), particles.lw.end(), (T)-log((double)particles.size()));
+		if (recovery)
+		{ // and look for the robot everywhere
+			resample(1.0);
+		}
+		return;
+	}
+	double inject = 0;
+	if (recovery && !sighted.empty())
+	{ // per sighting, so the average doesn't swing with the number of tags in view
+		inject = track_likelihood(lognorm / (sighted.size() / 4));
+	}
+	// only resample once the weights have degenerated, which is also when
+	// the random particles go in. The averages wobble enough that inject is
+	// often a little above zero while tracking fine, so on its own it only
+	// forces a resample when the drop is big, as after a kidnapping (where
+	// every particle is equally wrong and N_eff stays high)
+	if (inject > inject_threshold || effective_size() < resample_threshold * particles.size())
 	{
-		sim_robot &particle = particles[i];
-		mu += vec({ particle.x, particle.y, particle.t });
+		resample(inject);
 	}
-	mu /= particles.size();
-	sigma = zeros<mat>(3, 3);
-	// var = (Particle's x_i-Mean)^2 / N
-	for (int i = 0; i < particles.size(); i++)
+}
+
+/** Update the short and long term averages of the measurement likelihood
+ *	@param loglik the log of the average likelihood of this update
+ *	@return the chance of injecting a random particle, 1 - w_fast / w_slow
+ */
+template <typename T>
+double basic_pfilter<T>::track_likelihood(double loglik)
+{
+	double w_avg = exp(loglik);
+	w_slow += alpha_slow * (w_avg - w_slow);
+	w_fast += alpha_fast * (w_avg - w_fast);
+	if (!(w_slow > 0))
 	{
-		sim_robot &particle = particles[i];
-		vec pvec({ particle.x, particle.y, particle.t });
-		pvec -= mu;
-		sigma += pvec * pvec.t();
+		return 0;
 	}
-	sigma /= particles.size();
+	double inject = 1.0 - w_fast / w_slow;
+	return (inject > 0) ? inject : 0;
 }
 
-/** Blit all the particles onto the screen
- *	@param screen the screen to blit the particles onto
+/** Normalize the weights so that they sum to one
+ *	The linear weights are rebuilt from the log weights relative to the
+ *	largest one (log-sum-exp), and the log weights are shifted by the same
+ *	normalizer, so exp is called once per particle and never underflows all
+ *	the way to zero
+ *	@param lognorm (output) the log of the sum of the weights before
+ *		normalizing, which is the log of the average likelihood of the
+ *		last weigh
+ *	@return false if all of the weights are zero
  */
-void pfilter::blit(cube &screen, int mux, int muy)
+template <typename T>
+bool basic_pfilter<T>::normalize(double &lognorm)
 {
-	int i = 0;
-	for (sim_robot &bot : this->particles)
+	int N = particles.size();
+	T *pw = particles.w.data();
+	T *plw = particles.lw.data();
+	T maxlw = -HUGE_VAL;
+	for (int i = 0; i < N; i++)
 	{
-		int x = (int)round(bot.x) - mux + (int)screen.n_cols / 2;
-		int y = (int)round(bot.y) - muy + (int)screen.n_rows / 2;
-		if (x >= 0 && x < (int)screen.n_cols && y >= 0 && y < (int)screen.n_rows)
-		{
-			screen(y, x, 0) = 0;
-			screen(y, x, 1) = 1;
-			screen(y, x, 2) = 0;
-		}
-		i++;
+		maxlw = (plw[i] > maxlw) ? plw[i] : maxlw;
+	}
+	if (N == 0 || !(maxlw > -HUGE_VAL))
+	{
+		return false;
+	}
+	double total = 0;
+	for (int i = 0; i < N; i++)
+	{
+		pw[i] = exp(plw[i] - maxlw);
+		total += pw[i];
 	}
+	T scale = (T)(1.0 / total);
+	lognorm = maxlw + log(total);
+	T shift = (T)lognorm;
+	for (int i = 0; i < N; i++)
+	{
+		pw[i] *= scale;
+		plw[i] -= shift;
+	}
+	return true;
 }
 
-static double erfinv(double p)
+/** Get the effective sample size of the normalized weights, 1 / sum(w^2)
+ *	This is N for uniform weights, and drops towards 1 as a few particles
+ *	take all of the weight
+ *	@return the effective sample size
+ */
+template <typename T>
+double basic_pfilter<T>::effective_size(void)
 {
-	// approximate maclaurin series (refer to http://mathworld.wolfram.com/InverseErf.html)
-	double sqrt_pi = sqrt(M_PI);
-	vec a =
+	int N = particles.size();
+	const T *pw = particles.w.data();
+	double sumsq = 0;
+	for (int i = 0; i < N; i++)
 	{
-		0.88623,
-		0.23201,
-		0.12756,
-		0.086552
-	};
-	vec x(a.n_elem);
-	for (int i = 0; i < x.n_elem; i++)
+		sumsq += pw[i] * pw[i];
+	}
+	return (sumsq > 0) ? 1.0 / sumsq : 0;
+}
+
+/** Set when to resample: after each observation, the filter resamples only
+ *	if the effective sample size is below threshold * N
+ *	@param threshold the fraction of N, 1 resamples every time
+ */
+template <typename T>
+void basic_pfilter<T>::set_resample_threshold(double threshold)
+{
+	this->resample_threshold = threshold;
+}
+
+/** Turn on recovery from a wrong convergence or a kidnapping (augmented
+ *	MCL). When the short term average likelihood drops below the long term
+ *	one, resampling swaps in random particles from the open cells
+ *	@param alpha_slow the decay rate of the long term average
+ *	@param alpha_fast the decay rate of the short term average, should be
+ *		much bigger than alpha_slow (e.g. 0.001 and 0.1)
+ *	@param inject_threshold the injection chance that resamples on its own,
+ *		smaller ones wait for the effective sample size test
+ */
+template <typename T>
+void basic_pfilter<T>::set_recovery(double alpha_slow, double alpha_fast, double inject_threshold)
+{
+	this->recovery = true;
+	this->alpha_slow = alpha_slow;
+	this->alpha_fast = alpha_fast;
+	this->inject_threshold = inject_threshold;
+	this->w_slow = 0;
+	this->w_fast = 0;
+}
+
+/** Use a precomputed line of sight table in weigh. A sighting of a tag that
+ *	is behind a wall from the particle's cell isn't scored, it just gets a
+ *	flat penalty
+ *	@param visibility the table, built for this filter's map and landmarks,
+ *		and kept alive by the caller (it can be shared between filters)
+ *	@param occluded_loglik the log likelihood of seeing an occluded tag,
+ *		-HUGE_VAL rules those particles out entirely
+ *	@return false if the table was never built or doesn't cover this
+ *		filter's map, in which case it isn't used
+ */
+template <typename T>
+bool basic_pfilter<T>::set_visibility(const landmark_visibility *visibility, double occluded_loglik)
+{
+	this->occluded_loglik = occluded_loglik;
+	if (visibility && (visibility->empty() || !this->map ||
+		visibility->n_rows != (int)this->map->n_rows || visibility->n_cols != (int)this->map->n_cols))
+	{ // weigh looks up every particle's cell in it, so it has to match
+		this->visibility = NULL;
+		return false;
+	}
+	this->visibility = visibility;
+	return true;
+}
+
+/** Predict the position and calculate the error of the particle set
+ *	@param mu (output) the position ( x, y, theta )
+ *	@param sigma (output) the error
+ */
+template <typename T>
+void basic_pfilter<T>::predict(vec &mu, mat &sigma)
+{
+	pose_estimate pose;
+	estimate(pose);
+	mu = vec({ pose.x, pose.y, pose.t });
+	sigma = mat(3, 3);
+	for (int i = 0; i < 3; i++)
 	{
-		x(i) = pow(p, 2 * i + 1);
+		for (int j = 0; j < 3; j++)
+		{
+			sigma(i, j) = pose.cov[i * 3 + j];
+		}
 	}
-	return dot(a,x);
 }
 
-static double gaussianNoise(double sigma)
+/** Get the weighted mean pose (with a circular mean heading) and its
+ *	covariance, in one pass over the particles without allocating
+ *	@param pose (output) the pose estimate
+ */
+template <typename T>
+void basic_pfilter<T>::estimate(pose_estimate &pose)
 {
-	double p = (double)rand() / ((double)RAND_MAX / 2) - 1;
-	return erfinv(p) * sigma;
+	particles.estimate(pose, last.x, last.y, last.t);
+	last = pose;
 }
 
-static double gauss(double mu, double sigma2)
+/** Blit all the particles onto the screen
+ *	@param screen the screen to blit the particles onto
+ */
+template <typename T>
+void basic_pfilter<T>::blit(cube &screen, int mux, int muy)
 {
-	return 1 / sqrt(2 * M_PI * sigma2) * exp(-0.5 * (mu * mu) / sigma2);
+	for (int i = 0; i < particles.size(); i++)
+	{
+		int x = (int)round(particles.x[i]) - mux + (int)screen.n_cols / 2;
+		int y = (int)round(particles.y[i]) - muy + (int)screen.n_rows / 2;
+		if (x >= 0 && x < (int)screen.n_cols && y >= 0 && y < (int)screen.n_rows)
+		{
+			screen(y, x, 0) = 0;
+			screen(y, x, 1) = 1;
+			screen(y, x, 2) = 0;
+		}
+	}
 }
 
-static double secdiff(struct timeval &t1, struct timeval &t2)
+template <typename T>
+static inline T wrap180(T x)
 {
-	double usec = (double)(t2.tv_usec - t1.tv_usec) / 1000000.0;
-	double sec = (double)(t2.tv_sec - t1.tv_sec);
-	return sec + usec;
-}
\ No newline at end of file
+	return x - (T)360 * floor((x + (T)180) / (T)360);
+}
+
+template class basic_pfilter<float>;
+template class basic_pfilter<double>;
@@ -5,35 +5,94 @@
 #define pfilter_h
 
 #include <armadillo>
+#include <cstdint>
+#include <memory>
 #include <vector>
 
+#include "kld.h"
+#include "landmark_table.h"
+#include "localizer.h"
+#include "odometry.h"
+#include "particles.h"
+#include "rng.h"
 #include "sim_landmark.h"
 #include "sim_map.h"
-#include "sim_robot.h"
+#include "visibility.h"
+#include "workpool.h"
 
-class pfilter
+/** The particle filter, templated on the precision of the particles
+ *	The interface is in double either way, only the particle arrays and the
+ *	per-particle math are in T. Use the pfilter (double) and pfilter_f
+ *	(float) typedefs below
+ */
+template <typename T>
+class basic_pfilter : public localizer
 {
 	public:
-		pfilter(void);
-		pfilter(int nparticles, sim_map *map, std::vector<sim_landmark> &landmarks, double x, double y, double t, double initial_sigma);
-		~pfilter(void);
-		void move(arma::vec sensors);
+		basic_pfilter(void);
+		basic_pfilter(int nparticles, const sim_map *map, const landmark_table &landmarks, double x, double y, double t, double initial_sigma, uint64_t seed = 0, int nthreads = 1);
+		basic_pfilter(int nparticles, const sim_map *map, std::shared_ptr<const landmark_table> landmarks, double x, double y, double t, double initial_sigma, uint64_t seed = 0, int nthreads = 1);
+		~basic_pfilter(void);
+		void move(const odometry_sample &sample);
+		void set_odometry(const mecanum_odometry &odometry);
 		void observe(arma::mat observations);
+		void observe(const std::vector<tag_observation> &observations);
 		void predict(arma::vec &mu, arma::mat &sigma);
+		void estimate(pose_estimate &pose);
+		void reset(const pose_estimate &pose);
 		void set_noise(double vs, double ws);
 		void set_size(double r);
+		void set_adaptive(int nmin, int nmax, double binsize, double binangle);
+		void set_resample_threshold(double threshold);
+		void set_recovery(double alpha_slow, double alpha_fast, double inject_threshold = 0.3);
+		bool set_visibility(const landmark_visibility *visibility, double occluded_loglik = -10);
+		void set_measurement_noise(double range_sigma2, double bearing_sigma2);
+		double effective_size(void);
 		void blit(arma::cube &screen, int mux, int muy);
 
-		std::vector<sim_robot> particles;
-		sim_map *map;
+		basic_particle_set<T> particles;
+		const sim_map *map; // shared, read only
 
 	private:
-		void weigh(arma::mat &observations);
-		void resample(void);
+		void scatter(double x, double y, double t, double sx, double sy, double st);
+		void weigh(const std::vector<tag_observation> &observations);
+		void resample(double inject = 0);
+		bool normalize(double &lognorm);
+		double track_likelihood(double loglik);
+		void move_range(int worker, int begin, int end, T vx, T vy, T w);
+		void weigh_range(int begin, int end);
 
 		double vs;
 		double ws;
-		arma::vec health;
-		std::vector<sim_landmark> landmarks;
+		double r;
+		basic_particle_set<T> buffer; // back buffer for resampling
+		rng random;
+		std::vector<T> noise; // per-particle motion noise, drawn in one batch
+		std::shared_ptr<workpool> pool;
+		std::vector<rng> streams; // one noise stream per worker
+		bool adaptive;
+		kld_sampler kld;
+		double resample_threshold; // resample when N_eff < threshold * N
+		bool recovery; // inject random particles when the likelihood drops (augmented MCL)
+		double alpha_slow;
+		double alpha_fast;
+		double inject_threshold; // a drop this big resamples even if N_eff is fine
+		double w_slow; // long term average of the measurement likelihood
+		double w_fast; // short term average of the measurement likelihood
+		double range_coef; // 1 / (2 sigma2) of the range error
+		double bearing_coef; // 1 / (2 sigma2) of the bearing error
+		std::shared_ptr<const landmark_table> table; // shared, read only
+		std::vector<T> sighted; // (x, y, range, bearing) of each usable sighting
+		std::vector<int> sighted_bits; // visibility bit of each usable sighting
+		const landmark_visibility *visibility; // shared, may be NULL
+		double occluded_loglik; // log likelihood of seeing a tag through a wall
+		double last_sighting; // timestamp of the newest sighting weighed so far
+		std::vector<tag_observation> dense; // scratch for the dense observe
+		pose_estimate last; // the last estimate, the reference for the next one
+		mecanum_odometry odometry; // turns the encoders into (vx, vy, w)
 };
+
+typedef basic_pfilter<double> pfilter;
+typedef basic_pfilter<float> pfilter_f;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,149 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "pflog.h"
+
+using namespace std;
+
+pflog::pflog(void) :
+	x(0), y(0), t(0)
+{
+}
+
+pflog::~pflog(void)
+{
+}
+
+/** Read a log from a file
+ *	@param path the log file
+ *	@return false if the file can't be opened or a line is malformed
+ */
+bool pflog::load(const string &path)
+{
+	ifstream in(path.c_str());
+	if (!in)
+	{
+		return false;
+	}
+	this->map_name.clear();
+	this->landmarks = landmark_table();
+	this->frames.clear();
+	string line;
+	int lineno = 0;
+	int ntags = 0; // tags still expected for the last frame
+	while (getline(in, line))
+	{
+		lineno++;
+		istringstream ss(line);
+		string kind;
+		if (!(ss >> kind) || kind[0] == '#')
+		{
+			continue;
+		}
+		bool ok = true;
+		if (kind == "map")
+		{
+			ok = (bool)(ss >> this->map_name);
+		}
+		else if (kind == "landmark")
+		{
+			int id;
+			double lx, ly;
+			ok = (bool)(ss >> id >> lx >> ly) && id >= 0;
+			if (ok)
+			{
+				this->landmarks.set(id, lx, ly);
+			}
+		}
+		else if (kind == "start")
+		{
+			ok = (bool)(ss >> this->x >> this->y >> this->t);
+		}
+		else if (kind == "frame")
+		{
+			pflog_frame frame;
+			ok = (bool)(ss >> frame.odom.timestamp >> frame.odom.enc[0] >> frame.odom.enc[1] >> frame.odom.enc[2] >> frame.odom.enc[3] >> ntags);
+			frame.has_truth = false;
+			frame.x = frame.y = frame.t = 0;
+			this->frames.push_back(frame);
+		}
+		else if (kind == "tag")
+		{
+			tag_observation obs;
+			ok = !this->frames.empty() && ntags > 0 && (bool)(ss >> obs.id >> obs.range >> obs.bearing);
+			if (ok)
+			{
+				obs.timestamp = this->frames.back().odom.timestamp;
+				this->frames.back().tags.push_back(obs);
+				ntags--;
+			}
+		}
+		else if (kind == "truth")
+		{
+			ok = !this->frames.empty() && (bool)(ss >> this->frames.back().x >> this->frames.back().y >> this->frames.back().t);
+			if (ok)
+			{
+				this->frames.back().has_truth = true;
+			}
+		}
+		else
+		{
+			ok = false;
+		}
+		if (!ok)
+		{
+			fprintf(stderr, "[pflog] %s:%d: bad line\n", path.c_str(), lineno);
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Write the log to a file
+ *	@param path the log file
+ *	@return false if the file can't be written
+ */
+bool pflog::save(const string &path) const
+{
+	ofstream out(path.c_str());
+	if (!out)
+	{
+		return false;
+	}
+	out.precision(17);
+	out << "# pflog" << endl;
+	if (!this->map_name.empty())
+	{
+		out << "map " << this->map_name << endl;
+	}
+	for (int i = 0; i < this->landmarks.size(); i++)
+	{
+		if (this->landmarks.contains(i))
+		{
+			out << "landmark " << i << " " << this->landmarks.x[i] << " " << this->landmarks.y[i] << endl;
+		}
+	}
+	out << "start " << this->x << " " << this->y << " " << this->t << endl;
+	for (const pflog_frame &frame : this->frames)
+	{
+		out << "frame " << frame.odom.timestamp;
+		for (int i = 0; i < 4; i++)
+		{
+			out << " " << frame.odom.enc[i];
+		}
+		out << " " << frame.tags.size() << endl;
+		for (const tag_observation &obs : frame.tags)
+		{
+			out << "tag " << obs.id << " " << obs.range << " " << obs.bearing << endl;
+		}
+		if (frame.has_truth)
+		{
+			out << "truth " << frame.x << " " << frame.y << " " << frame.t << endl;
+		}
+	}
+	return (bool)out;
+}
@@ -0,0 +1,53 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#ifndef PFLOG_H
+#define PFLOG_H
+
+#include <string>
+#include <vector>
+
+#include "landmark_table.h"
+#include "odometry.h"
+#include "sim_landmark.h"
+
+/** One update of the localization loop: the encoders, the tags that were
+ *	seen, and (if it is known) where the robot really was
+ */
+struct pflog_frame
+{
+	odometry_sample odom;
+	std::vector<tag_observation> tags;
+	bool has_truth;
+	double x;
+	double y;
+	double t;
+};
+
+/** A recorded localization run that can be replayed without the robot
+ *	The file is plain text, one record per line:
+ *		map <image file>
+ *		landmark <id> <x> <y>
+ *		start <x> <y> <t>
+ *		frame <timestamp> <enc0> <enc1> <enc2> <enc3> <ntags>
+ *		tag <id> <range> <bearing>		(ntags of these follow each frame)
+ *		truth <x> <y> <t>				(optional, after the tags)
+ *	Lines starting with # are comments
+ */
+class pflog
+{
+	public:
+		pflog(void);
+		~pflog(void);
+		bool load(const std::string &path);
+		bool save(const std::string &path) const;
+
+		std::string map_name;
+		landmark_table landmarks; // only the ids with a landmark line are valid
+		double x; // the pose the filter is seeded with
+		double y;
+		double t;
+		std::vector<pflog_frame> frames;
+};
+
+#endif
@@ -0,0 +1,105 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+// Replays a recorded log through the float and the double particle filter
+// with the same seed, and reports how far apart the two estimates drift and
+// how each does against the ground truth
+//
+//	usage: pfprecision <log> [nparticles] [seed]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "pfilter.h"
+#include "pflog.h"
+
+using namespace std;
+
+static double wrap180(double x)
+{
+	return x - 360.0 * floor((x + 180.0) / 360.0);
+}
+
+/** Running position/heading error stats
+ */
+struct error_stats
+{
+	int n;
+	double sumsq_pos;
+	double max_pos;
+	double sumsq_t;
+	double max_t;
+
+	void add(double dx, double dy, double dt)
+	{
+		double pos = sqrt(dx * dx + dy * dy);
+		dt = fabs(wrap180(dt));
+		n++;
+		sumsq_pos += pos * pos;
+		max_pos = (pos > max_pos) ? pos : max_pos;
+		sumsq_t += dt * dt;
+		max_t = (dt > max_t) ? dt : max_t;
+	}
+
+	void print(const char *name) const
+	{
+		if (n == 0)
+		{
+			printf("%-18s (no frames)\n", name);
+			return;
+		}
+		printf("%-18s rms %9.4f  max %9.4f  | heading rms %8.4f  max %8.4f\n", name,
+			sqrt(sumsq_pos / n), max_pos, sqrt(sumsq_t / n), max_t);
+	}
+};
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		printf("usage: %s <log> [nparticles] [seed]\n", argv[0]);
+		return 1;
+	}
+	pflog log;
+	if (!log.load(argv[1]))
+	{
+		printf("could not read %s\n", argv[1]);
+		return 1;
+	}
+	int nparticles = (argc > 2) ? atoi(argv[2]) : 500;
+	uint64_t seed = (argc > 3) ? strtoull(argv[3], NULL, 10) : 0;
+
+	sim_map map;
+	map.load(log.map_name);
+	pfilter pfd(nparticles, &map, log.landmarks, log.x, log.y, log.t, 100, seed);
+	pfilter_f pff(nparticles, &map, log.landmarks, log.x, log.y, log.t, 100, seed);
+	pfd.set_noise(0.1, 0.2);
+	pff.set_noise(0.1, 0.2);
+
+	error_stats delta = error_stats();
+	error_stats truthd = error_stats();
+	error_stats truthf = error_stats();
+	pose_estimate ed, ef;
+	for (const pflog_frame &frame : log.frames)
+	{
+		pfd.move(frame.odom);
+		pff.move(frame.odom);
+		pfd.observe(frame.tags);
+		pff.observe(frame.tags);
+		pfd.estimate(ed);
+		pff.estimate(ef);
+		delta.add(ef.x - ed.x, ef.y - ed.y, ef.t - ed.t);
+		if (frame.has_truth)
+		{
+			truthd.add(ed.x - frame.x, ed.y - frame.y, ed.t - frame.t);
+			truthf.add(ef.x - frame.x, ef.y - frame.y, ef.t - frame.t);
+		}
+	}
+
+	printf("%d frames, %d particles, seed %llu\n", (int)log.frames.size(), nparticles, (unsigned long long)seed);
+	delta.print("float - double");
+	truthd.print("double - truth");
+	truthf.print("float - truth");
+	return 0;
+}
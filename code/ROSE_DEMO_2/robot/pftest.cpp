@@ -0,0 +1,210 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+// Checks of the particle filter's contracts that don't need the robot or a
+// recorded log, each on a small walled room built in memory
+//
+//	usage: pftest
+//
+// Prints each check and exits with the number that failed
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "ekf.h"
+#include "pfilter.h"
+#include "visibility.h"
+
+using namespace arma;
+using namespace std;
+
+/** Make an empty room with a one cell wall around it
+ *	@param map (output) the room
+ *	@param n_rows the height
+ *	@param n_cols the width
+ */
+static void make_room(sim_map &map, int n_rows, int n_cols)
+{
+	map.map = mat(n_rows, n_cols);
+	for (int y = 0; y < n_rows; y++)
+	{
+		for (int x = 0; x < n_cols; x++)
+		{
+			bool wall = x == 0 || y == 0 || x == n_cols - 1 || y == n_rows - 1;
+			map.map(y, x) = wall ? 1 : 0;
+		}
+	}
+	map.n_rows = n_rows;
+	map.n_cols = n_cols;
+	map.reindex();
+}
+
+/** Compare two weights, allowing for the rounding of renormalizing
+ */
+static bool same(double a, double b)
+{
+	return fabs(a - b) <= 1e-9 * fabs(b);
+}
+
+static vector<sim_landmark> room_landmarks(void)
+{
+	vector<sim_landmark> landmarks;
+	landmarks.push_back(sim_landmark(2, 2));
+	landmarks.push_back(sim_landmark(77, 2));
+	landmarks.push_back(sim_landmark(40, 57));
+	return landmarks;
+}
+
+/** A table that was never built, or was built for a map of another size,
+ *	can't be indexed by this filter's cells, so it has to be turned away
+ */
+static bool check_visibility_mismatch(void)
+{
+	sim_map room;
+	make_room(room, 60, 80);
+	sim_map other;
+	make_room(other, 40, 80);
+	landmark_table table(room_landmarks());
+	workpool pool(1);
+
+	pfilter pf(200, &room, table, 40, 30, 0, 5, 1);
+	landmark_visibility unbuilt;
+	if (pf.set_visibility(&unbuilt))
+	{
+		printf("  an unbuilt table was accepted\n");
+		return false;
+	}
+	landmark_visibility wrong;
+	wrong.build(other, table, pool);
+	if (pf.set_visibility(&wrong))
+	{
+		printf("  a table for a %d x %d map was accepted on a %d x %d one\n",
+			wrong.n_rows, wrong.n_cols, (int)room.n_rows, (int)room.n_cols);
+		return false;
+	}
+	landmark_visibility right;
+	right.build(room, table, pool);
+	if (!pf.set_visibility(&right))
+	{
+		printf("  the table for this map was turned away\n");
+		return false;
+	}
+	return true;
+}
+
+/** The weights carry over between updates, so handing the filter the same
+ *	sightings again (the camera hasn't produced a new frame) must not count
+ *	them twice
+ */
+static bool check_repeated_sightings(void)
+{
+	sim_map room;
+	make_room(room, 60, 80);
+	pfilter pf(200, &room, landmark_table(room_landmarks()), 40, 30, 0, 5, 1);
+	pf.set_resample_threshold(0); // keep the weights where they are
+
+	vector<tag_observation> sightings;
+	tag_observation a = { 0, 45.3, -142.0, 1.0 };
+	tag_observation b = { 2, 27.0, 90.0, 1.0 };
+	sightings.push_back(a);
+	sightings.push_back(b);
+
+	pf.observe(sightings);
+	vector<double> w(pf.particles.w.begin(), pf.particles.w.end());
+	vector<double> lw(pf.particles.lw.begin(), pf.particles.lw.end());
+	bool uniform = true;
+	for (size_t i = 1; i < w.size(); i++)
+	{
+		uniform = uniform && w[i] == w[0];
+	}
+	if (uniform)
+	{
+		printf("  the first sightings didn't change the weights\n");
+		return false;
+	}
+
+	pf.observe(sightings);
+	for (size_t i = 0; i < w.size(); i++)
+	{
+		if (!same(pf.particles.w[i], w[i]) || !same(pf.particles.lw[i], lw[i]))
+		{
+			printf("  particle %d went from %g to %g\n", (int)i, w[i], (double)pf.particles.w[i]);
+			return false;
+		}
+	}
+
+	// a newer frame of the same tags does count
+	for (tag_observation &obs : sightings)
+	{
+		obs.timestamp = 1.1;
+	}
+	pf.observe(sightings);
+	for (size_t i = 0; i < w.size(); i++)
+	{
+		if (!same(pf.particles.w[i], w[i]))
+		{
+			return true;
+		}
+	}
+	printf("  a newer frame was skipped\n");
+	return false;
+}
+
+/** The same for the EKF, whose covariance only ever shrinks on a sighting
+ */
+static bool check_repeated_sightings_ekf(void)
+{
+	landmark_table table(room_landmarks());
+	ekf tracker(table);
+	pose_estimate start = { 40, 30, 0, { 25, 0, 0, 0, 25, 0, 0, 0, 25 } };
+	tracker.reset(start);
+
+	vector<tag_observation> sightings;
+	tag_observation a = { 0, 45.3, -142.0, 1.0 };
+	sightings.push_back(a);
+
+	pose_estimate before;
+	pose_estimate once;
+	pose_estimate twice;
+	tracker.estimate(before);
+	tracker.observe(sightings);
+	tracker.estimate(once);
+	tracker.observe(sightings);
+	tracker.estimate(twice);
+	if (once.cov[0] == before.cov[0] && once.cov[4] == before.cov[4])
+	{
+		printf("  the first sighting didn't change the covariance\n");
+		return false;
+	}
+	for (int i = 0; i < 9; i++)
+	{
+		if (twice.cov[i] != once.cov[i])
+		{
+			printf("  cov[%d] went from %g to %g\n", i, once.cov[i], twice.cov[i]);
+			return false;
+		}
+	}
+	return twice.x == once.x && twice.y == once.y && twice.t == once.t;
+}
+
+int main(void)
+{
+	struct
+	{
+		const char *name;
+		bool (*run)(void);
+	} checks[] = {
+		{ "visibility table has to match the map", check_visibility_mismatch },
+		{ "repeated sightings leave the weights alone", check_repeated_sightings },
+		{ "repeated sightings leave the EKF alone", check_repeated_sightings_ekf },
+	};
+	int nfailed = 0;
+	for (const auto &check : checks)
+	{
+		bool ok = check.run();
+		printf("%-48s %s\n", check.name, ok ? "ok" : "FAILED");
+		nfailed += ok ? 0 : 1;
+	}
+	return nfailed;
+}
@@ -0,0 +1,18 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#ifndef POSE_H
+#define POSE_H
+
+/** A pose estimate with its uncertainty
+ *	cov is row major over ( x, y, theta ), theta in degrees
+ */
+struct pose_estimate
+{
+	double x;
+	double y;
+	double t;
+	double cov[9];
+};
+
+#endif
@@ -0,0 +1,81 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#include <cmath>
+
+#include "pose_service.h"
+
+using namespace std;
+
+pose_service::pose_service(void) : valid(false), stamp(0), vx(0), vy(0), w(0), horizon(0.5)
+{
+	last = pose_estimate();
+}
+
+pose_service::~pose_service(void)
+{
+}
+
+/** Publish a new estimate
+ *	@param pose the estimate
+ *	@param twist the motion over the last encoder sample, turned into rates
+ *		so the next queries can carry the pose forward; a twist with no dt
+ *		means the robot is treated as standing still
+ *	@param timestamp the time of the encoder sample the estimate is for
+ */
+void pose_service::publish(const pose_estimate &pose, const odometry_twist &twist, double timestamp)
+{
+	lock_guard<mutex> guard(this->lock);
+	this->last = pose;
+	this->stamp = timestamp;
+	if (twist.dt > 0)
+	{
+		this->vx = twist.vx / twist.dt;
+		this->vy = twist.vy / twist.dt;
+		this->w = twist.w / twist.dt;
+	}
+	else
+	{
+		this->vx = 0;
+		this->vy = 0;
+		this->w = 0;
+	}
+	this->valid = true;
+}
+
+/** Get the pose at a given time
+ *	Queries from before the last estimate get the estimate itself, and
+ *	queries past the horizon stop there, so a stalled localizer can't
+ *	send the pose off on its own. The covariance is the estimate's
+ *	@param timestamp the time to get the pose for, same clock as publish
+ *	@param pose (output) the extrapolated pose
+ *	@return false if nothing has been published yet
+ */
+bool pose_service::query(double timestamp, pose_estimate &pose)
+{
+	lock_guard<mutex> guard(this->lock);
+	pose = this->last;
+	if (!this->valid)
+	{
+		return false;
+	}
+	double h = timestamp - this->stamp;
+	h = (h < 0) ? 0 : ((h > this->horizon) ? this->horizon : h);
+	double t = this->last.t + this->w * h;
+	double a = t * M_PI / 180.0;
+	double c = cos(a);
+	double s = sin(a);
+	pose.x += (this->vy * c + this->vx * s) * h;
+	pose.y += (this->vy * s - this->vx * c) * h;
+	pose.t = t - 360.0 * floor((t + 180.0) / 360.0);
+	return true;
+}
+
+/** Set how far ahead the pose will be extrapolated
+ *	@param seconds the horizon
+ */
+void pose_service::set_horizon(double seconds)
+{
+	lock_guard<mutex> guard(this->lock);
+	this->horizon = seconds;
+}
@@ -0,0 +1,38 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#ifndef POSE_SERVICE_H
+#define POSE_SERVICE_H
+
+#include <mutex>
+
+#include "odometry.h"
+#include "pose.h"
+
+/** The latest pose, for anyone who needs it without waiting on the filter
+ *	The localizer publishes each estimate with the time of the encoder
+ *	sample it was computed from and the twist over that sample. Readers ask
+ *	for the pose at some time, and get the estimate carried forward at that
+ *	twist's rates, using the same turn-then-translate model as the particles
+ */
+class pose_service
+{
+	public:
+		pose_service(void);
+		~pose_service(void);
+		void publish(const pose_estimate &pose, const odometry_twist &twist, double timestamp);
+		bool query(double timestamp, pose_estimate &pose);
+		void set_horizon(double seconds);
+
+	private:
+		std::mutex lock;
+		bool valid;
+		pose_estimate last; // the last published estimate
+		double stamp; // when it was true
+		double vx; // sideways rate, per second
+		double vy; // forward rate, per second
+		double w; // turn rate, degrees per second
+		double horizon; // the furthest it will extrapolate, in seconds
+};
+
+#endif
@@ -0,0 +1,211 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#include <cmath>
+
+#include "rng.h"
+
+#define ZIG_LAYERS 128
+#define ZIG_R 3.442619855899
+#define ZIG_V 9.91256303526217e-3
+
+struct ziggurat
+{
+	double x[ZIG_LAYERS + 1]; // layer edges, x[0] is the base strip
+	double ratio[ZIG_LAYERS]; // x[i+1] / x[i], the fast accept test
+
+	ziggurat(void)
+	{
+		double f = exp(-0.5 * ZIG_R * ZIG_R);
+		x[0] = ZIG_V / f;
+		x[1] = ZIG_R;
+		x[ZIG_LAYERS] = 0;
+		for (int i = 2; i < ZIG_LAYERS; i++)
+		{
+			x[i] = sqrt(-2 * log(ZIG_V / x[i-1] + f));
+			f = exp(-0.5 * x[i] * x[i]);
+		}
+		for (int i = 0; i < ZIG_LAYERS; i++)
+		{
+			ratio[i] = x[i+1] / x[i];
+		}
+	}
+};
+
+static const ziggurat &zigtable(void)
+{
+	static const ziggurat table;
+	return table;
+}
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t splitmix64(uint64_t &x)
+{
+	uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+/** Create a new engine
+ *	@param seed the seed, the same seed gives the same sequence
+ */
+rng::rng(uint64_t seed)
+{
+	this->seed(seed);
+}
+
+rng::~rng(void)
+{
+}
+
+/** Reseed the engine (splitmix64 expands the seed into the full state)
+ *	@param seed the seed
+ */
+void rng::seed(uint64_t seed)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		this->state[i] = splitmix64(seed);
+	}
+}
+
+/** Advance the engine by 2^128 draws. Calling this k times on copies of
+ *	one engine gives k non-overlapping streams
+ */
+void rng::jump(void)
+{
+	static const uint64_t JUMP[] =
+	{
+		0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+		0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+	};
+	uint64_t s[4] = { 0, 0, 0, 0 };
+	for (int i = 0; i < 4; i++)
+	{
+		for (int b = 0; b < 64; b++)
+		{
+			if (JUMP[i] & (1ULL << b))
+			{
+				for (int j = 0; j < 4; j++)
+				{
+					s[j] ^= this->state[j];
+				}
+			}
+			this->next();
+		}
+	}
+	for (int j = 0; j < 4; j++)
+	{
+		this->state[j] = s[j];
+	}
+}
+
+/** Get the next 64 random bits (xoshiro256**)
+ */
+uint64_t rng::next(void)
+{
+	uint64_t *s = this->state;
+	uint64_t result = rotl(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+	return result;
+}
+
+/** Get a uniform sample on [0, 1)
+ */
+double rng::uniform(void)
+{
+	return (double)(this->next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/** Get a standard normal sample using the ziggurat method
+ *	(Marsaglia & Tsang, with Doornik's 128 layer double precision tables)
+ */
+double rng::gaussian(void)
+{
+	const ziggurat &zig = zigtable();
+	while (true)
+	{
+		uint64_t bits = this->next();
+		int i = (int)(bits & (ZIG_LAYERS - 1));
+		// top 53 bits as a signed uniform on (-1, 1)
+		double u = (double)(bits >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+		if (fabs(u) < zig.ratio[i])
+		{
+			return u * zig.x[i]; // inside the rectangle, ~99% of draws
+		}
+		if (i == 0)
+		{ // sample from the tail beyond ZIG_R
+			double a, b;
+			do
+			{
+				a = -log(1.0 - this->uniform()) / ZIG_R;
+				b = -log(1.0 - this->uniform());
+			} while (b + b < a * a);
+			return (u < 0) ? -(ZIG_R + a) : ZIG_R + a;
+		}
+		double xx = u * zig.x[i];
+		double f0 = exp(-0.5 * (zig.x[i] * zig.x[i] - xx * xx));
+		double f1 = exp(-0.5 * (zig.x[i+1] * zig.x[i+1] - xx * xx));
+		if (f1 + this->uniform() * (f0 - f1) < 1.0)
+		{
+			return xx;
+		}
+	}
+}
+
+/** Get a normal sample
+ *	@param sigma the standard deviation
+ */
+double rng::gaussian(double sigma)
+{
+	return this->gaussian() * sigma;
+}
+
+/** Fill an array with uniform samples on [0, 1)
+ *	@param out the array
+ *	@param n the number of samples
+ */
+void rng::uniform(double *out, int n)
+{
+	for (int i = 0; i < n; i++)
+	{
+		out[i] = this->uniform();
+	}
+}
+
+/** Fill an array with normal samples
+ *	@param out the array
+ *	@param n the number of samples
+ *	@param sigma the standard deviation
+ */
+void rng::gaussian(double *out, int n, double sigma)
+{
+	for (int i = 0; i < n; i++)
+	{
+		out[i] = this->gaussian() * sigma;
+	}
+}
+
+/** Fill an array with single precision normal samples
+ *	@param out the array
+ *	@param n the number of samples
+ *	@param sigma the standard deviation
+ */
+void rng::gaussian(float *out, int n, double sigma)
+{
+	for (int i = 0; i < n; i++)
+	{
+		out[i] = (float)(this->gaussian() * sigma);
+	}
+}
@@ -0,0 +1,38 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+
+// the old erfinv sampler had a spread of sigma/sqrt(2), so the noise
+// parameters tuned against it (vs, ws, initial_sigma) are scaled by this
+// before they go to gaussian(), to keep meaning the same thing
+#define RNG_NOISE_SCALE 0.70710678118654752440
+
+/** Random number engine for the localization code
+ *	Uses xoshiro256** for the raw bits and the ziggurat method for normals
+ *	Every instance owns its own state, so the same seed always reproduces
+ *	the same sequence regardless of what else is running in the process
+ */
+class rng
+{
+	public:
+		rng(uint64_t seed = 0);
+		~rng(void);
+		void seed(uint64_t seed);
+		void jump(void);
+		uint64_t next(void);
+		double uniform(void);
+		double gaussian(void);
+		double gaussian(double sigma);
+		void uniform(double *out, int n);
+		void gaussian(double *out, int n, double sigma);
+		void gaussian(float *out, int n, double sigma);
+
+	private:
+		uint64_t state[4];
+};
+
+#endif
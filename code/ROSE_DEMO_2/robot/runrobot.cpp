@@ -16,6 +16,8 @@
 #include "astar.h"
 #include "chili_landmarks.h"
 #include "draw.h"
+#include "dstar.h"
+#include "ekf.h"
 #include "ipcdb.h"
 #include "mathfun.h"
 #include "pfilter.h"
@@ -47,6 +49,7 @@ static void database_update(void)
 static string state = "waiting";
 
 static double secdiff(struct timeval &t1, struct timeval &t2);
+static double timestamp_now(void);
 
 static void stoprunning(int signum)
 {
@@ -127,6 +130,11 @@ int main()
 	double initial_y = 60;
 	double initial_t = 90;
 	robot_pose = vec({ initial_x, initial_y, initial_t });
+	pose_estimate initial_pose = pose_estimate();
+	initial_pose.x = initial_x;
+	initial_pose.y = initial_y;
+	initial_pose.t = initial_t;
+	pose_server.publish(initial_pose, odometry_twist(), timestamp_now());
 	globalmap.load("ece_hallway_partial.jpg"); // lower corner is (0,0)
 
 	// start up the threads
@@ -299,28 +307,44 @@ void manual_input(void)
 
 void chilitag_detect(void)
 {
+	vector<tag_observation> obs;
+	int seen = -1;
 	while (!stopsig)
 	{
-		// place the chilitags' positions into a matrix
-		mat sv(3, 20, fill::zeros);
-		for (int j = 0; j < 20; j++)
+		// only a new camera frame is a new set of sightings, so the
+		// localizers can tell a repeat by its timestamp
+		int frame = chili.frames;
+		if (frame == seen)
 		{
-			if (chili.tags[j][0] != 0.0)
-			{
-				sv.col(j) = vec({ chili.tags[j][1], chili.tags[j][2], chili.tags[j][0]/*, chili.tags[j][3] */ });
-			}
+			usleep(5000);
+			continue;
 		}
+		seen = frame;
+		double timestamp = timestamp_now();
 
-		for (int j = 0; j < 20; j++)
+		// place the seen chilitags into a list, and the first 20 into a
+		// matrix for the display
+		mat sv(3, 20, fill::zeros);
+		obs.clear();
+		for (int j = 0; j < 1024; j++)
 		{
-			vec pt({ sv(0, j), sv(1, j) });
-			sv(0, j) = eucdist(pt);
-			sv(1, j) = angle(pt);
+			if (chili.tags[j][0] == 0.0)
+			{
+				continue;
+			}
+			vec pt({ chili.tags[j][1], chili.tags[j][2] });
+			tag_observation o = { j, eucdist(pt), angle(pt), timestamp };
+			obs.push_back(o);
+			if (j < 20)
+			{
+				sv.col(j) = vec({ o.range, o.bearing, chili.tags[j][0] });
+			}
 		}
 
-		// store the matrix
+		// store the sightings
 		chili_lock.lock();
 		chilitags = sv;
+		chiliobs = obs;
 		chili_lock.unlock();
 	}
 }
@@ -328,26 +352,11 @@ void chilitag_detect(void)
 void localize_pose(void)
 {
 	// create the landmarks (custom)
-	landmarks.push_back(sim_landmark(8, 240-24));				// 00
-	landmarks.push_back(sim_landmark(8, 480-24));				// 01
-	landmarks.push_back(sim_landmark(8, 720-24));				// 02
-	landmarks.push_back(sim_landmark(8, 960-24));				// 03
-	landmarks.push_back(sim_landmark(8, 1200-24));				// 04
-	landmarks.push_back(sim_landmark(146, 1200-24));			// 05
-	landmarks.push_back(sim_landmark(146, 960-24));				// 06
-	landmarks.push_back(sim_landmark(146, 720-24));				// 07
-	landmarks.push_back(sim_landmark(146, 480-24));				// 08
-	landmarks.push_back(sim_landmark(146, 240-24));				// 09
-	landmarks.push_back(sim_landmark(8, 240));					// 10
-	landmarks.push_back(sim_landmark(8, 480));					// 11
-	landmarks.push_back(sim_landmark(8, 720));					// 12
-	landmarks.push_back(sim_landmark(8, 960));					// 13
-	landmarks.push_back(sim_landmark(8, 1200));					// 14
-	landmarks.push_back(sim_landmark(146, 1200));				// 15
-	landmarks.push_back(sim_landmark(146, 960));				// 16
-	landmarks.push_back(sim_landmark(146, 720));				// 17
-	landmarks.push_back(sim_landmark(146, 480));				// 18
-	landmarks.push_back(sim_landmark(146, 240));				// 19
+	landmarks = hallway_landmarks();
+
+	// trace which tags can be seen from each cell, once for the whole map
+	workpool builders((int)thread::hardware_concurrency());
+	visibility.build(globalmap, landmark_table(landmarks), builders);
 
 	// start the particle filter
 	pose_lock.lock();
@@ -358,31 +367,102 @@ void localize_pose(void)
 	double t = robot_pose(2);
 	double vs = 0.1;
 	double ws = 0.2;
-	pf = pfilter(nparticles, &globalmap, landmarks, x, y, t, initial_sigma);
+	uint64_t seed = 0;
+	int nthreads = 1; // most of the other threads here are busy loops
+	pf = pfilter(nparticles, &globalmap, landmarks, x, y, t, initial_sigma, seed, nthreads);
 	pf.set_noise(vs, ws);
+	pf.set_adaptive(100, 5000, 10, 10); // grows when lost, shrinks once converged
+	pf.set_recovery(0.001, 0.1); // reseed from open space if it gets lost
+	pf.set_visibility(&visibility);
+	mecanum_odometry odometry;
+	odometry.load("calib_params.json");
+	pf.set_odometry(odometry);
 	pose_lock.unlock();
 
-	// loop on the particle filter for updates on the location
-	vec mu;
-	mat sigma;
+	// once the cloud has been tight for a while it's a single gaussian, so
+	// hand over to the kalman filter, which costs next to nothing, and take
+	// back over when the tags stop agreeing with it
+	ekf tracker(landmarks);
+	tracker.set_noise(vs, ws);
+	tracker.set_odometry(odometry);
+	localizer *active = &pf;
+	const double handover_sigma = 5; // map units
+	const double handover_sigma_t = 5; // degrees
+	const int handover_updates = 10; // how long it has to stay tight
+	const int max_failures = 3; // gated updates in a row before giving up
+	int tight = 0;
+
+	// the latest twist, so the pose server can carry the pose forward
+	mecanum_odometry motion = odometry;
+	motion.reset();
+	odometry_twist twist = odometry_twist();
+
+	// Rose only refreshes the encoders every SYNC_NSEC, so most reads here
+	// repeat the last one. Only a reading that changed is a new sample, so
+	// the twist's dt is the time between real readings. A stopped robot
+	// never changes them, so once they've been still this long take a
+	// sample anyway, which brings the twist down to zero
+	const double still_time = 0.25; // seconds
+	odometry_sample sample = odometry_sample();
+	bool sampled = false;
+
+	// loop on the localizer for updates on the location
+	pose_estimate pose;
 	while (!stopsig)
 	{
-		// move the robot
-		pf.move(rose.recv());
+		// move the robot, if the encoders have anything new
+		vec sensors = rose.recv();
+		double now = timestamp_now();
+		bool changed = !sampled || now - sample.timestamp > still_time;
+		for (int i = 0; i < 4; i++)
+		{
+			changed = changed || sensors(i) != sample.enc[i];
+		}
+		if (changed)
+		{
+			sample.timestamp = now;
+			for (int i = 0; i < 4; i++)
+			{
+				sample.enc[i] = sensors(i);
+			}
+			active->move(sample);
+			motion.update(sample, twist);
+			sampled = true;
+		}
 
 		// get the chilitags
 		chili_lock.lock();
-		mat landmarks = chilitags;
+		vector<tag_observation> sightings = chiliobs;
 		chili_lock.unlock();
 
 		// observe and predict the robot's new location
-		pf.observe(landmarks);
-		pf.predict(mu, sigma);
+		active->observe(sightings);
+		active->estimate(pose);
+
+		if (active == &pf)
+		{
+			bool converged = pose.cov[0] < handover_sigma * handover_sigma &&
+				pose.cov[4] < handover_sigma * handover_sigma &&
+				pose.cov[8] < handover_sigma_t * handover_sigma_t;
+			tight = converged ? tight + 1 : 0;
+			if (tight >= handover_updates)
+			{
+				tracker.reset(pose);
+				active = &tracker;
+			}
+		}
+		else if (tracker.failures() >= max_failures)
+		{
+			pf.reset(pose);
+			active = &pf;
+			tight = 0;
+		}
 
 		// store the new location
 		pose_lock.lock();
-		robot_pose = mu;
+		robot_pose = vec({ pose.x, pose.y, pose.t });
 		pose_lock.unlock();
+		pose_server.publish(pose, twist, sample.timestamp);
 	}
 }
 
@@ -1043,12 +1123,11 @@ void robot_calcmotion(void)
 
 	}
 
-	// 	// get the current position of the robot
-	// 	pose_lock.lock();
-	// 	vec pose = robot_pose;
-	// 	pose_lock.unlock();
-	// 	vec pos = pose(span(0,1));
-	// 	double theta = pose(2);
+	// 	// get the current position of the robot, carried forward to now
+	// 	pose_estimate current;
+	// 	pose_server.query(timestamp_now(), current);
+	// 	vec pos({ current.x, current.y });
+	// 	double theta = current.t;
 
 	// 	// get the current plan
 	// 	path_lock.lock();
@@ -1179,7 +1258,9 @@ void motion_plan(void)
 	// // grab the map
 	// mat localmap = globalmap.map;
 
-	// AStar astar(localmap, goal);
+	// // the search is kept between iterations, so replanning every time
+	// // around only repairs what moving since the last one changed
+	// DStarLite planner(localmap, goal);
 	while (!stopsig)
 	{
 	// 	// try and see if we are allowed to go autonomous
@@ -1203,8 +1284,8 @@ void motion_plan(void)
 	// 	// compute the new path
 	// 	vector<MotionAction> actionpath;
 	// 	vec curr = pose(span(0,1));
-	// 	astar.compute(curr, actionpath);
-	// 	if (astar.impossible())
+	// 	planner.compute(curr, actionpath);
+	// 	if (planner.impossible())
 	// 	{
 	// 		// store an empty path
 	// 		path_lock.lock();
@@ -1260,10 +1341,10 @@ void display_interface(void)
 	{
 		frame.zeros();
 
-		// get the position of the robot
-		pose_lock.lock();
-		vec pose = robot_pose;
-		pose_lock.unlock();
+		// get the position of the robot, carried forward to now
+		pose_estimate current;
+		pose_server.query(timestamp_now(), current);
+		vec pose({ current.x, current.y, current.t });
 
 		// create a window around the pose
 		int mux = (int)round(pose(0));
@@ -1341,3 +1422,13 @@ static double secdiff(struct timeval &t1, struct timeval &t2)
 	double sec = (double)(t2.tv_sec - t1.tv_sec);
 	return sec + usec;
 }
+
+/** Get the wall clock time, the clock the encoder samples are stamped with
+ *	@return the time in seconds
+ */
+static double timestamp_now(void)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return (double)now.tv_sec + (double)now.tv_usec / 1000000.0;
+}
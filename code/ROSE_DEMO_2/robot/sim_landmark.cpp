@@ -92,4 +92,34 @@ void sim_landmark::blit(cube &screen, int mux, int muy, vec place_circle)
 	{
 		draw_circle(screen, white, vec({ (double)x_, (double)y_ }), eucdist(place_circle.subvec(0,1)));
 	}
-}
\ No newline at end of file
+}
+
+/** The tags along the hallway in ece_hallway_partial.jpg, where landmark i
+ *	is tag i
+ *	@return the landmarks
+ */
+std::vector<sim_landmark> hallway_landmarks(void)
+{
+	std::vector<sim_landmark> landmarks;
+	landmarks.push_back(sim_landmark(8, 240-24));				// 00
+	landmarks.push_back(sim_landmark(8, 480-24));				// 01
+	landmarks.push_back(sim_landmark(8, 720-24));				// 02
+	landmarks.push_back(sim_landmark(8, 960-24));				// 03
+	landmarks.push_back(sim_landmark(8, 1200-24));				// 04
+	landmarks.push_back(sim_landmark(146, 1200-24));			// 05
+	landmarks.push_back(sim_landmark(146, 960-24));				// 06
+	landmarks.push_back(sim_landmark(146, 720-24));				// 07
+	landmarks.push_back(sim_landmark(146, 480-24));				// 08
+	landmarks.push_back(sim_landmark(146, 240-24));				// 09
+	landmarks.push_back(sim_landmark(8, 240));					// 10
+	landmarks.push_back(sim_landmark(8, 480));					// 11
+	landmarks.push_back(sim_landmark(8, 720));					// 12
+	landmarks.push_back(sim_landmark(8, 960));					// 13
+	landmarks.push_back(sim_landmark(8, 1200));					// 14
+	landmarks.push_back(sim_landmark(146, 1200));				// 15
+	landmarks.push_back(sim_landmark(146, 960));				// 16
+	landmarks.push_back(sim_landmark(146, 720));				// 17
+	landmarks.push_back(sim_landmark(146, 480));				// 18
+	landmarks.push_back(sim_landmark(146, 240));				// 19
+	return landmarks;
+}
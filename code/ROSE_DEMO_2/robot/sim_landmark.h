@@ -5,10 +5,25 @@
 #define SIM_LANDMARK_H
 
 #include <armadillo>
+#include <vector>
 
 #include "sim_map.h"
 #include "sim_robot.h"
 
+/** One sighting of a tagged landmark, relative to the robot
+ *	The timestamp is when the camera frame it came from was taken. The
+ *	localizers skip sightings that are no newer than ones they have already
+ *	used, so handing them the same frame again is harmless. 0 means
+ *	unstamped, and those are always used
+ */
+struct tag_observation
+{
+	int id; // tag id, which is also the landmark's index
+	double range;
+	double bearing; // degrees
+	double timestamp; // seconds, same clock as the odometry samples
+};
+
 class sim_landmark
 {
 	public:
@@ -21,4 +36,6 @@ class sim_landmark
 		double y;
 };
 
+std::vector<sim_landmark> hallway_landmarks(void);
+
 #endif
\ No newline at end of file
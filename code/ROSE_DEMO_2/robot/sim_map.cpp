@@ -22,6 +22,59 @@ void sim_map::load(const std::string &map_name)
 	this->map = (this->map < 0.5) % ones<mat>(this->map.n_rows, this->map.n_cols);
 	this->n_rows = this->map.n_rows;
 	this->n_cols = this->map.n_cols;
+	this->reindex();
+}
+
+/** Rebuild the list of open cells and the wall counts, call this after
+ *	changing the map
+ */
+void sim_map::reindex(void)
+{
+	this->occupancy.build(this->map);
+	this->free_cells.clear();
+	for (int y = 0; y < (int)this->n_rows; y++)
+	{
+		for (int x = 0; x < (int)this->n_cols; x++)
+		{
+			if (this->map(y, x) <= 0.5)
+			{
+				this->free_cells.push_back(y * (int)this->n_cols + x);
+			}
+		}
+	}
+}
+
+/** See whether a point is on the map and not inside a wall
+ *	@param x the x position
+ *	@param y the y position
+ *	@return true if the point is open
+ */
+bool sim_map::is_free(double x, double y) const
+{
+	int x_ = (int)round(x);
+	int y_ = (int)round(y);
+	return x_ >= 0 && x_ < (int)this->n_cols && y_ >= 0 && y_ < (int)this->n_rows && this->map(y_, x_) <= 0.5;
+}
+
+/** Pick a uniformly random open point, in O(1)
+ *	@param random the random number engine to draw from
+ *	@param x (output) the x position
+ *	@param y (output) the y position
+ *	@return false if the map has no open cells
+ */
+bool sim_map::sample_free(rng &random, double &x, double &y) const
+{
+	if (this->free_cells.empty())
+	{
+		return false;
+	}
+	int i = (int)(random.uniform() * this->free_cells.size());
+	int cell = this->free_cells[i];
+	// anywhere inside the cell, with a little margin so that it still
+	// rounds back to the cell after a cast to float
+	x = cell % (int)this->n_cols + (random.uniform() - 0.5) * 0.98;
+	y = cell / (int)this->n_cols + (random.uniform() - 0.5) * 0.98;
+	return true;
 }
 
 void sim_map::blit(cube &screen, int x, int y)
@@ -6,7 +6,10 @@
 
 #include <armadillo>
 #include <string>
+#include <vector>
 
+#include "integral.h"
+#include "rng.h"
 #include "sdldef.h"
 
 class sim_map
@@ -16,10 +19,15 @@ class sim_map
 		~sim_map(void);
 		void load(const std::string &map_name);
 		void blit(arma::cube &screen, int x, int y);
+		void reindex(void);
+		bool is_free(double x, double y) const;
+		bool sample_free(rng &random, double &x, double &y) const;
 
 		arma::mat map;
 		arma::uword n_rows;
 		arma::uword n_cols;
+		std::vector<int> free_cells; // row major index (y * n_cols + x) of every open cell
+		integral_image occupancy; // for counting the walls in a rectangle
 };
 
 #endif
\ No newline at end of file
@@ -10,7 +10,13 @@
 using namespace arma;
 using namespace std;
 
-sim_robot::sim_robot(sim_map *map)
+/** Make a robot on a map
+ *	@param map the map, shared and read only
+ *	@param seed the seed for the motion noise, give every robot in a fleet
+ *		its own so they don't all slip the same way
+ */
+sim_robot::sim_robot(const sim_map *map, uint64_t seed) :
+	random(seed)
 {
 	this->map = map;
 	this->x = 0;
@@ -65,12 +71,8 @@ bool sim_robot::collided(double x, double y)
 	int t = (int)round((double)y - this->r/2);
 	int r = l + this->r - 1;
 	int b = t + this->r - 1;
-	l = MAX(0, l);
-	t = MAX(0, t);
-	r = MIN(this->map->n_cols-1, r);
-	b = MIN(this->map->n_rows-1, b);
-	mat f = this->map->map.submat(t, l, b, r);
-	return (accu(f) > 0);
+	// the footprint is clipped to the map by the count
+	return this->map->occupancy.count(t, l, b, r) > 0;
 }
 
 static bool within(double x, double a, double b)
@@ -78,28 +80,13 @@ static bool within(double x, double a, double b)
 	return a <= x && x <= b;
 }
 
-static double erfinv(double p)
+/** Draw motion noise from this robot's own engine
+ *	The noise parameters are on the old scale, see RNG_NOISE_SCALE
+ *	@param sigma the noise parameter
+ */
+double sim_robot::gaussianNoise(double sigma)
 {
-	// approximate maclaurin series (refer to http://mathworld.wolfram.com/InverseErf.html)
-	vec a =
-	{
-		0.88623,
-		0.23201,
-		0.12756,
-		0.086552
-	};
-	vec x(a.n_elem);
-	for (int i = 0; i < x.n_elem; i++)
-	{
-		x(i) = pow(p, 2 * i + 1);
-	}
-	return dot(a,x);
-}
-
-static double gaussianNoise(double sigma)
-{
-	double p = (double)rand() / ((double)RAND_MAX / 2) - 1;
-	return erfinv(p) * sigma;
+	return this->random.gaussian(sigma * RNG_NOISE_SCALE);
 }
 
 void sim_robot::move(double vx, double vy, double w)
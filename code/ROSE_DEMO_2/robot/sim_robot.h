@@ -7,12 +7,13 @@
 #include <armadillo>
 #include <string>
 
+#include "rng.h"
 #include "sim_map.h"
 
 class sim_robot
 {
 	public:
-		sim_robot(sim_map *map = NULL);
+		sim_robot(const sim_map *map = NULL, uint64_t seed = 0);
 		~sim_robot(void);
 		void set_size(double r);
 		void set_pose(double x, double y, double t);
@@ -27,11 +28,14 @@ class sim_robot
 		double r;
 		double vs;
 		double ws;
-		sim_map *map;
+		const sim_map *map; // shared, read only
 		void *lidar;
 
 	private:
 		bool collided(double x, double y);
+		double gaussianNoise(double sigma);
+
+		rng random;
 };
 
 #endif
\ No newline at end of file
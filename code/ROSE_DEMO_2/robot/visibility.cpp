@@ -0,0 +1,206 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#include <cmath>
+#include <string>
+#include <unordered_map>
+
+#include "visibility.h"
+
+using namespace std;
+
+landmark_visibility::landmark_visibility(void) :
+	n_rows(0), n_cols(0), words(0)
+{
+}
+
+landmark_visibility::~landmark_visibility(void)
+{
+}
+
+/** Trace every (open cell, landmark) pair on the map. The ray casting is
+ *	split over the pool by rows, then the bitsets are deduplicated
+ *	@param map the map, with its walls
+ *	@param table the landmark positions
+ *	@param pool the workers to build with
+ *	@param margin how many cells short of the landmark the ray stops, since
+ *		a tag is mounted on a wall
+ */
+void landmark_visibility::build(const sim_map &map, const landmark_table &table, workpool &pool, int margin)
+{
+	this->n_rows = (int)map.n_rows;
+	this->n_cols = (int)map.n_cols;
+	int ncells = this->n_rows * this->n_cols;
+
+	// give the tags that are on the map consecutive bits
+	this->bits.assign(table.size(), -1);
+	vector<int> ids;
+	for (int id = 0; id < table.size(); id++)
+	{
+		if (table.contains(id))
+		{
+			this->bits[id] = (int)ids.size();
+			ids.push_back(id);
+		}
+	}
+	this->words = ((int)ids.size() + 63) / 64;
+	if (this->words == 0)
+	{
+		this->words = 1;
+	}
+	int nwords = this->words;
+
+	// one byte per cell, so the rays don't go through the double map
+	vector<uint8_t> occupied(ncells);
+	for (int y = 0; y < this->n_rows; y++)
+	{
+		for (int x = 0; x < this->n_cols; x++)
+		{
+			occupied[y * this->n_cols + x] = map.map(y, x) > 0.5;
+		}
+	}
+
+	// STEP 1: the raw bitset of every cell, walls see nothing
+	vector<uint64_t> raw((size_t)ncells * nwords, 0);
+	pool.run(this->n_rows, [&](int /*worker*/, int begin, int end)
+	{
+		for (int y = begin; y < end; y++)
+		{
+			for (int x = 0; x < this->n_cols; x++)
+			{
+				int cell = y * this->n_cols + x;
+				if (occupied[cell])
+				{
+					continue;
+				}
+				uint64_t *set = raw.data() + (size_t)cell * nwords;
+				for (int k = 0; k < (int)ids.size(); k++)
+				{
+					if (this->clear(occupied, x, y, table.x[ids[k]], table.y[ids[k]], margin))
+					{
+						set[k >> 6] |= (uint64_t)1 << (k & 63);
+					}
+				}
+			}
+		}
+	});
+
+	// STEP 2: keep each distinct bitset once
+	vector<uint32_t> index(ncells);
+	this->patterns.clear();
+	unordered_map<string, uint32_t> dictionary;
+	for (int cell = 0; cell < ncells; cell++)
+	{
+		const uint64_t *set = raw.data() + (size_t)cell * nwords;
+		string key((const char *)set, nwords * sizeof(uint64_t));
+		auto found = dictionary.find(key);
+		if (found != dictionary.end())
+		{
+			index[cell] = found->second;
+			continue;
+		}
+		uint32_t next = (uint32_t)(this->patterns.size() / nwords);
+		dictionary[key] = next;
+		this->patterns.insert(this->patterns.end(), set, set + nwords);
+		index[cell] = next;
+	}
+
+	// STEP 3: store the indices as narrow as the dictionary allows
+	size_t npatterns = this->patterns.size() / nwords;
+	this->cells8.clear();
+	this->cells16.clear();
+	this->cells32.clear();
+	if (npatterns <= 0x100)
+	{
+		this->cells8.assign(index.begin(), index.end());
+	}
+	else if (npatterns <= 0x10000)
+	{
+		this->cells16.assign(index.begin(), index.end());
+	}
+	else
+	{
+		this->cells32.swap(index);
+	}
+}
+
+/** See whether the table has been built
+ *	@return true if there is nothing to look up
+ */
+bool landmark_visibility::empty(void) const
+{
+	return this->patterns.empty();
+}
+
+/** Get the bit of a tag
+ *	@param id the tag id
+ *	@return the bit index, or -1 if the tag isn't on the map
+ */
+int landmark_visibility::bit(int id) const
+{
+	return (id >= 0 && id < (int)this->bits.size()) ? this->bits[id] : -1;
+}
+
+/** Get the bitset of the landmarks that can be seen from a cell
+ *	@param x the cell column
+ *	@param y the cell row
+ *	@return the bitset, words long
+ */
+const uint64_t *landmark_visibility::pattern(int x, int y) const
+{
+	return this->patterns.data() + (size_t)this->index(y * this->n_cols + x) * this->words;
+}
+
+/** See whether a landmark can be seen from a cell
+ *	@param x the cell column
+ *	@param y the cell row
+ *	@param id the tag id
+ *	@return true if the line of sight is clear
+ */
+bool landmark_visibility::visible(int x, int y, int id) const
+{
+	int k = this->bit(id);
+	if (k < 0 || x < 0 || x >= this->n_cols || y < 0 || y >= this->n_rows)
+	{
+		return false;
+	}
+	return (this->pattern(x, y)[k >> 6] >> (k & 63)) & 1;
+}
+
+/** March from a cell towards a landmark, one cell length at a time
+ *	@return true if no wall is in the way
+ */
+bool landmark_visibility::clear(const vector<uint8_t> &occupied, int x, int y, double lx, double ly, int margin) const
+{
+	double dx = lx - x;
+	double dy = ly - y;
+	double radius = sqrt(dx * dx + dy * dy);
+	int steps = (int)radius - margin;
+	if (steps <= 0)
+	{
+		return true;
+	}
+	dx /= radius;
+	dy /= radius;
+	// step along the ray incrementally, +0.5 so that the cast rounds. The
+	// map is a rectangle, so if the far end is on it the whole ray is too
+	double fx = x + 0.5;
+	double fy = y + 0.5;
+	double ex = fx + dx * steps;
+	double ey = fy + dy * steps;
+	if (ex < 0 || ex >= this->n_cols || ey < 0 || ey >= this->n_rows)
+	{
+		return false;
+	}
+	const uint8_t *grid = occupied.data();
+	for (int r = 1; r <= steps; r++)
+	{
+		fx += dx;
+		fy += dy;
+		if (grid[(int)fy * this->n_cols + (int)fx])
+		{
+			return false;
+		}
+	}
+	return true;
+}
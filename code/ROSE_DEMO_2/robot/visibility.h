@@ -0,0 +1,61 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#ifndef VISIBILITY_H
+#define VISIBILITY_H
+
+#include <cstdint>
+#include <vector>
+
+#include "landmark_table.h"
+#include "sim_map.h"
+#include "workpool.h"
+
+/** Which landmarks have a clear line of sight from each map cell
+ *	Every cell has a bitset over the landmarks (bit k is the k-th tag in the
+ *	table), but neighboring cells almost always see the same set, so only
+ *	the distinct bitsets are kept, and each cell stores an index into that
+ *	dictionary. The index is as narrow as the dictionary allows, a byte for
+ *	the few dozen patterns a floor with a handful of tags has, so the table
+ *	is a byte per cell instead of a bitset per cell
+ */
+class landmark_visibility
+{
+	public:
+		landmark_visibility(void);
+		~landmark_visibility(void);
+		void build(const sim_map &map, const landmark_table &table, workpool &pool, int margin = 3);
+		bool empty(void) const;
+		int bit(int id) const;
+		const uint64_t *pattern(int x, int y) const;
+		bool visible(int x, int y, int id) const;
+
+		int n_rows;
+		int n_cols;
+		int words; // 64 bit words per bitset
+		std::vector<int> bits; // tag id -> bit index, -1 if the tag isn't on the map
+		// row major, index of each cell's bitset. Only the narrowest one that
+		// fits the dictionary is filled in
+		std::vector<uint8_t> cells8;
+		std::vector<uint16_t> cells16;
+		std::vector<uint32_t> cells32;
+		std::vector<uint64_t> patterns; // the distinct bitsets, words apiece
+
+	private:
+		uint32_t index(int cell) const
+		{
+			if (!this->cells8.empty())
+			{
+				return this->cells8[cell];
+			}
+			if (!this->cells16.empty())
+			{
+				return this->cells16[cell];
+			}
+			return this->cells32[cell];
+		}
+
+		bool clear(const std::vector<uint8_t> &occupied, int x, int y, double lx, double ly, int margin) const;
+};
+
+#endif
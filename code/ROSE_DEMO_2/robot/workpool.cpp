@@ -0,0 +1,218 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#include "workpool.h"
+
+using namespace std;
+
+/** Start up the pool. The calling thread acts as worker 0, so only
+ *	nworkers - 1 threads are spawned
+ *	@param nworkers the number of workers
+ */
+workpool::workpool(int nworkers) :
+	job(NULL), jobsize(0), generation(0), pending(0), stopping(false), stealing(false), grain(1),
+	slots(new range_slot[nworkers < 1 ? 1 : nworkers])
+{
+	for (int i = 1; i < nworkers; i++)
+	{
+		this->threads.push_back(thread(&workpool::worker_loop, this, i));
+	}
+}
+
+workpool::~workpool(void)
+{
+	this->lock.lock();
+	this->stopping = true;
+	this->lock.unlock();
+	this->start_signal.notify_all();
+	for (thread &t : this->threads)
+	{
+		t.join();
+	}
+}
+
+/** Get the number of workers, including the calling thread
+ *	@return the number of workers
+ */
+int workpool::size(void) const
+{
+	return (int)this->threads.size() + 1;
+}
+
+/** Run a job over [0, n), one chunk per worker, and wait for it to finish
+ *	@param n the number of items
+ *	@param job the job, called as job(worker, begin, end)
+ */
+void workpool::run(int n, const job_t &job)
+{
+	if (this->threads.empty())
+	{
+		job(0, 0, n);
+		return;
+	}
+
+	this->lock.lock();
+	this->job = &job;
+	this->jobsize = n;
+	this->stealing = false;
+	this->pending = (int)this->threads.size();
+	this->generation++;
+	this->lock.unlock();
+	this->start_signal.notify_all();
+
+	// do our own share while the workers do theirs
+	job(0, 0, this->chunk_begin(1, n));
+
+	unique_lock<mutex> lk(this->lock);
+	this->done_signal.wait(lk, [this] { return this->pending == 0; });
+}
+
+static inline uint64_t pack_range(uint32_t begin, uint32_t end)
+{
+	return (uint64_t)begin | ((uint64_t)end << 32);
+}
+
+/** Run a job over [0, n) with work stealing, and wait for it to finish
+ *	Which worker runs which items depends on the timing, so the job must
+ *	not care. Use it when the items cost very different amounts, like
+ *	robots that only sometimes have to plan
+ *	@param n the number of items
+ *	@param job the job, called as job(worker, begin, end) on small ranges
+ *	@param grain the number of items a worker takes from its own range at a
+ *		time
+ */
+void workpool::run_stealing(int n, const job_t &job, int grain)
+{
+	if (this->threads.empty())
+	{
+		job(0, 0, n);
+		return;
+	}
+	for (int i = 0; i < this->size(); i++)
+	{
+		this->slots[i].range.store(pack_range(this->chunk_begin(i, n), this->chunk_begin(i + 1, n)));
+	}
+
+	this->lock.lock();
+	this->job = &job;
+	this->jobsize = n;
+	this->stealing = true;
+	this->grain = (grain < 1) ? 1 : grain;
+	this->pending = (int)this->threads.size();
+	this->generation++;
+	this->lock.unlock();
+	this->start_signal.notify_all();
+
+	this->drain(0, job);
+
+	unique_lock<mutex> lk(this->lock);
+	this->done_signal.wait(lk, [this] { return this->pending == 0; });
+}
+
+/** Work through this worker's range, then help the others until there is
+ *	nothing left anywhere
+ */
+void workpool::drain(int id, const job_t &job)
+{
+	int begin;
+	int end;
+	while (this->pop(id, begin, end) || (this->steal(id) && this->pop(id, begin, end)))
+	{
+		job(id, begin, end);
+	}
+}
+
+/** Take the next few items off the front of this worker's range
+ *	@return false if the range is empty
+ */
+bool workpool::pop(int id, int &begin, int &end)
+{
+	atomic<uint64_t> &slot = this->slots[id].range;
+	uint64_t v = slot.load();
+	while (true)
+	{
+		uint32_t b = (uint32_t)v;
+		uint32_t e = (uint32_t)(v >> 32);
+		if (b >= e)
+		{
+			return false;
+		}
+		uint32_t nb = (e - b > (uint32_t)this->grain) ? b + this->grain : e;
+		if (slot.compare_exchange_weak(v, pack_range(nb, e)))
+		{
+			begin = (int)b;
+			end = (int)nb;
+			return true;
+		}
+	}
+}
+
+/** Move the back half of another worker's range into this worker's own,
+ *	which is empty. Nobody else writes to an empty range, so a plain store
+ *	is enough
+ *	@return false if every other range is empty
+ */
+bool workpool::steal(int id)
+{
+	int nworkers = this->size();
+	for (int k = 1; k < nworkers; k++)
+	{
+		atomic<uint64_t> &victim = this->slots[(id + k) % nworkers].range;
+		uint64_t v = victim.load();
+		while (true)
+		{
+			uint32_t b = (uint32_t)v;
+			uint32_t e = (uint32_t)(v >> 32);
+			if (b >= e)
+			{
+				break;
+			}
+			uint32_t mid = e - (e - b + 1) / 2;
+			if (victim.compare_exchange_weak(v, pack_range(b, mid)))
+			{
+				this->slots[id].range.store(pack_range(mid, e));
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void workpool::worker_loop(int id)
+{
+	int seen = 0;
+	while (true)
+	{
+		unique_lock<mutex> lk(this->lock);
+		this->start_signal.wait(lk, [this, seen] { return this->stopping || this->generation != seen; });
+		if (this->stopping)
+		{
+			return;
+		}
+		seen = this->generation;
+		const job_t *job = this->job;
+		int n = this->jobsize;
+		bool stealing = this->stealing;
+		lk.unlock();
+
+		if (stealing)
+		{
+			this->drain(id, *job);
+		}
+		else
+		{
+			(*job)(id, this->chunk_begin(id, n), this->chunk_begin(id + 1, n));
+		}
+
+		lk.lock();
+		if (--this->pending == 0)
+		{
+			this->done_signal.notify_one();
+		}
+	}
+}
+
+int workpool::chunk_begin(int id, int n) const
+{
+	return (int)((long long)n * id / this->size());
+}
@@ -0,0 +1,65 @@
+// Written by:	Ajay Srivastava, Srihari Chekuri
+// Tested by: 	Ajay Srivastava, Srihari Chekuri
+
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** A small persistent pool of worker threads for data parallel loops
+ *	run() splits [0, n) into one contiguous chunk per worker and blocks
+ *	until every chunk is done. The split only depends on n and the worker
+ *	count, so worker k always gets the same chunk for the same inputs.
+ *	run_stealing() is for items of uneven cost: each worker starts on the
+ *	same chunk, but takes it a few items at a time, and a worker that runs
+ *	out steals the back half of whatever another worker has left
+ */
+class workpool
+{
+	public:
+		typedef std::function<void(int worker, int begin, int end)> job_t;
+
+		workpool(int nworkers = 1);
+		~workpool(void);
+		int size(void) const;
+		void run(int n, const job_t &job);
+		void run_stealing(int n, const job_t &job, int grain = 1);
+
+	private:
+		void worker_loop(int id);
+		int chunk_begin(int id, int n) const;
+		void drain(int id, const job_t &job);
+		bool pop(int id, int &begin, int &end);
+		bool steal(int id);
+
+		// what is left of one worker's items, begin in the low half and end
+		// in the high half, so that both ends change in a single CAS
+		struct range_slot
+		{
+			std::atomic<uint64_t> range;
+			char padding[56]; // keep each on its own cache line
+		};
+
+		std::vector<std::thread> threads;
+		std::mutex lock;
+		std::condition_variable start_signal;
+		std::condition_variable done_signal;
+		const job_t *job;
+		int jobsize;
+		int generation;
+		int pending;
+		bool stopping;
+		bool stealing; // the current job is a run_stealing one
+		int grain; // items taken at a time by run_stealing
+		std::unique_ptr<range_slot[]> slots; // one per worker
+
+};
+
+#endif